@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vector>
+
+// rows of bits packed into 64-bit words, bits beyond the columns are kept zero
+class BitTable {
+private:
+  int nRows;
+  int nCols;
+  int nWords;
+  std::vector<unsigned long long> data;
+
+  unsigned long long LastMask() const {
+    return (nCols & 63)? (1ull << (nCols & 63)) - 1: ~0ull;
+  }
+
+public:
+  BitTable(): nRows(0), nCols(0), nWords(0) {}
+  BitTable(int nRows, int nCols, bool val = false) {
+    Resize(nRows, nCols, val);
+  }
+
+  void Resize(int nRows_, int nCols_, bool val = false) {
+    nRows = nRows_;
+    nCols = nCols_;
+    nWords = (nCols + 63) >> 6;
+    data.assign((size_t)nRows * nWords, val? ~0ull: 0ull);
+    if(val && nWords) {
+      for(int i = 0; i < nRows; i++) {
+        Row(i)[nWords - 1] &= LastMask();
+      }
+    }
+  }
+
+  int Rows() const {
+    return nRows;
+  }
+  int Cols() const {
+    return nCols;
+  }
+  int Words() const {
+    return nWords;
+  }
+
+  unsigned long long *Row(int i) {
+    return data.data() + (size_t)i * nWords;
+  }
+  unsigned long long const *Row(int i) const {
+    return data.data() + (size_t)i * nWords;
+  }
+
+  bool Get(int i, int j) const {
+    return (Row(i)[j >> 6] >> (j & 63)) & 1;
+  }
+  void Set(int i, int j, bool val) {
+    if(val) {
+      Row(i)[j >> 6] |= 1ull << (j & 63);
+    } else {
+      Row(i)[j >> 6] &= ~(1ull << (j & 63));
+    }
+  }
+
+  bool IsAllOnes(int i) const {
+    unsigned long long const *r = Row(i);
+    for(int k = 0; k < nWords - 1; k++) {
+      if(~r[k]) {
+        return false;
+      }
+    }
+    return !nWords || r[nWords - 1] == LastMask();
+  }
+  int CountOnes(int i) const {
+    unsigned long long const *r = Row(i);
+    int n = 0;
+    for(int k = 0; k < nWords; k++) {
+      n += __builtin_popcountll(r[k]);
+    }
+    return n;
+  }
+  // column of the first one at j or later, or the number of columns if none
+  int FindOne(int i, int j = 0) const {
+    if(j >= nCols) {
+      return nCols;
+    }
+    unsigned long long const *r = Row(i);
+    int k = j >> 6;
+    unsigned long long w = r[k] & (~0ull << (j & 63));
+    while(!w) {
+      if(++k == nWords) {
+        return nCols;
+      }
+      w = r[k];
+    }
+    return (k << 6) + __builtin_ctzll(w);
+  }
+  bool Intersects(int i, int i2) const {
+    unsigned long long const *r = Row(i);
+    unsigned long long const *r2 = Row(i2);
+    for(int k = 0; k < nWords; k++) {
+      if(r[k] & r2[k]) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool operator==(BitTable const &other) const {
+    return nRows == other.nRows && nCols == other.nCols && data == other.data;
+  }
+};
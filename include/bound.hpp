@@ -0,0 +1,5 @@
+#pragma once
+
+#include "bittable.hpp"
+
+int GetLowerBound(BitTable const &br, BitTable const *sim);
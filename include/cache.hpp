@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <fstream>
+
+#include <aig.hpp>
+
+#include "bittable.hpp"
+
+class SynthCache {
+private:
+  struct Entry {
+    int nLowerBound;
+    aigman *aig;
+  };
+
+  std::mutex mtx;
+  std::unordered_map<std::string, Entry> m;
+  std::ofstream f;
+
+  bool Update(std::string const &key, int nLowerBound, aigman const *aig);
+  void Append(std::string const &key, Entry const &entry);
+
+public:
+  ~SynthCache();
+
+  // loads records of a file and appends new results to it
+  void Open(std::string const &fname);
+
+  static std::string GetKey(BitTable const &br, BitTable const *sim);
+
+  bool Lookup(std::string const &key, int nGates, aigman *&aig, int &nLowerBound);
+  void Insert(std::string const &key, int nGates, aigman const *aig);
+};
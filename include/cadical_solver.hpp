@@ -5,7 +5,7 @@
 
 #include "solver.hpp"
 
-class CadicalSolver: public Solver {
+class CadicalSolver: public Solver, private CaDiCaL::Terminator {
 private:
   CaDiCaL::Solver *S;
   int nClauses;
@@ -32,6 +32,21 @@ private:
     AddClause(-res[k]);
   }
 
+  bool terminate() {
+    return Stop();
+  }
+
+  void SetLimits() {
+    StartTimer();
+    if(HasStop()) {
+      S->connect_terminator(this);
+    }
+    // the limit applies to the next solve only
+    if(nConflictLimit > 0) {
+      S->limit("conflicts", nConflictLimit);
+    }
+  }
+
 public:
   CadicalSolver(): S(new CaDiCaL::Solver), nClauses(0) {}
   ~CadicalSolver() {
@@ -39,11 +54,13 @@ public:
   }
 
   int Solve() {
+    SetLimits();
     int res = S->solve();
     return res == 10? 1: res == 20? -1: 0;
   }
 
   int Solve(std::vector<int> const &assumption, std::set<int> &core) {
+    SetLimits();
     for(int i: assumption) {
       S->assume(i);
     }
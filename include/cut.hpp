@@ -3,11 +3,61 @@
 #include <aig.hpp>
 
 struct Cut {
-  std::vector<int> leaves;
+  static const int nMaxLeaves = 16;
+
+  int nLeaves;
+  int leaves[nMaxLeaves];
   unsigned long long signature;
+  int volume; // estimated number of gates covered
+
+  Cut(): nLeaves(0), signature(0), volume(0) {}
+  Cut(int i): nLeaves(1), signature(1ull << (i % 64)), volume(0) {
+    leaves[0] = i;
+  }
+
+  int size() const {
+    return nLeaves;
+  }
+  int const *begin() const {
+    return leaves;
+  }
+  int const *end() const {
+    return leaves + nLeaves;
+  }
+};
+
+// cuts of all nodes stored contiguously, node by node
+class CutSets {
+private:
+  std::vector<Cut> vCuts;
+  std::vector<int> begins;
+
+  friend void CutEnumeration(aigman const &aig, CutSets &cuts, unsigned cutsize, int nCutLimit, bool fVolume, CutSets const *cuts_old, std::vector<int> const *vMap);
+
+public:
+  struct Range {
+    Cut const *b;
+    Cut const *e;
+    Cut const *begin() const {
+      return b;
+    }
+    Cut const *end() const {
+      return e;
+    }
+    int size() const {
+      return e - b;
+    }
+  };
 
-  Cut() {}
-  Cut(int i): leaves(std::vector<int>{i}), signature(1ull << (i % 64)) {}
+  int Size() const {
+    return (int)begins.size() - 1;
+  }
+  Range operator[](int i) const {
+    return Range{vCuts.data() + begins[i], vCuts.data() + begins[i + 1]};
+  }
 };
 
-void CutEnumeration(aigman const &aig, std::vector<std::vector<Cut> > &cuts, unsigned cutsize = 6);
+// at most nCutLimit cuts are kept per node if it is positive, preferring
+// fewer leaves, or larger volume if fVolume
+// cuts_old are reused for nodes mapped by vMap, which must have the same structure
+void CutEnumeration(aigman const &aig, CutSets &cuts, unsigned cutsize = 6, int nCutLimit = 0, bool fVolume = false, CutSets const *cuts_old = NULL, std::vector<int> const *vMap = NULL);
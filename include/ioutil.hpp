@@ -5,6 +5,7 @@
 #include <string>
 
 #include "cut.hpp"
+#include "bittable.hpp"
 
 template <typename T>
 std::ostream &operator<<(std::ostream &os, std::vector<T> const &v) {
@@ -24,3 +25,7 @@ void PrintVecWithIndex(std::vector<T> const &v, std::string prefix = "") {
     std::cout << prefix << i << " : " << v[i] << std::endl;
   }
 }
+
+void PrintCutsWithIndex(CutSets const &cuts, std::string prefix = "");
+
+void PrintTableWithIndex(BitTable const &t, std::string prefix = "");
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <iostream>
-#include <cstdlib>
+#include <vector>
 
 extern "C" {
   #include <kissat.h>
@@ -13,15 +13,33 @@ class KissatSolver: public Solver {
 private:
   kissat *S;
   int nClauses;
+  bool fSolved;
+  // clauses separated by 0, replayed into a fresh instance after each solve
+  std::vector<int> vClauses;
 
   void AddClause_(std::vector<int> const &vLits) {
+    if(fSolved) {
+      Reset();
+    }
     for(int i = 0; i < (int)vLits.size(); i++) {
       kissat_add(S, vLits[i]);
     }
     kissat_add(S, 0);
+    vClauses.insert(vClauses.end(), vLits.begin(), vLits.end());
+    vClauses.push_back(0);
     nClauses++;
   }
 
+  // kissat solves only once, so solving again starts over from the clauses
+  void Reset() {
+    kissat_release(S);
+    S = kissat_init();
+    for(int i: vClauses) {
+      kissat_add(S, i);
+    }
+    fSolved = false;
+  }
+
   bool Value_(int i) {
     return kissat_value(S, i) > 0;
   }
@@ -36,21 +54,47 @@ private:
     AddClause(-res[k]);
   }
 
+  static int Terminate(void *p) {
+    return ((KissatSolver *)p)->Stop();
+  }
+
 public:
-  KissatSolver(): S(kissat_init()), nClauses(0) {}
+  KissatSolver(): S(kissat_init()), nClauses(0), fSolved(false) {}
   ~KissatSolver() {
     kissat_release(S);
   }
 
   int Solve() {
+    if(fSolved) {
+      Reset();
+    }
+    StartTimer();
+    if(HasStop()) {
+      kissat_set_terminate(S, this, Terminate);
+    }
+    if(nConflictLimit > 0) {
+      kissat_set_conflict_limit(S, nConflictLimit);
+    }
+    fSolved = true;
     int res = kissat_solve(S);
     return res == 10? 1: res == 20? -1: 0;
   }
 
+  // assumptions are added as unit clauses of this solve only,
+  // and the core is all of them since kissat cannot tell failed ones
   int Solve(std::vector<int> const &assumption, std::set<int> &core) {
-    (void)assumption;
-    (void)core;
-    std::abort();
+    if(fSolved) {
+      Reset();
+    }
+    for(int i: assumption) {
+      kissat_add(S, i);
+      kissat_add(S, 0);
+    }
+    int res = Solve();
+    if(res == -1) {
+      core.insert(assumption.begin(), assumption.end());
+    }
+    return res;
   }
 
   void PrintStat() {
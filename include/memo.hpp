@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <unordered_set>
+
+#include <aig.hpp>
+
+// windows on which synthesis failed, identified by structural hashes
+class FailureMemo {
+private:
+  std::mutex mtx;
+  std::unordered_set<unsigned long long> s;
+
+public:
+  bool Find(unsigned long long key);
+  void Insert(unsigned long long key);
+};
+
+// hashes of the fanin cone and the fanout cone of each node, which do not depend on node ids
+void GetStructuralHashes(aigman const &aig, std::vector<unsigned long long> &hfis, std::vector<unsigned long long> &hfos);
+
+// updates hashes after renumbering, where vMap maps nodes to old ones with the same structure,
+// and fChanged marks unmatched nodes and nodes whose fanouts differ from those of the old ones
+void UpdateStructuralHashes(aigman const &aig, std::vector<int> const &vMap, std::vector<bool> const &fChanged, std::vector<unsigned long long> &hfis, std::vector<unsigned long long> &hfos);
+
+unsigned long long GetWindowKey(std::vector<unsigned long long> const &hfis, std::vector<unsigned long long> const &hfos, std::vector<int> const &inputs, std::vector<int> const &gates, std::vector<int> const &outputs);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+
+#include <aig.hpp>
+
+#include "bittable.hpp"
+
+struct NpnTransform {
+  // canonical input k is original input inperm[k] complemented by bit k of inneg
+  std::vector<int> inperm;
+  unsigned inneg;
+  // canonical output k is original output outperm[k] complemented by bit k of outneg
+  std::vector<int> outperm;
+  unsigned outneg;
+};
+
+void Canonicalize(BitTable const &br, BitTable const *sim, BitTable &br_c, BitTable &sim_c, NpnTransform &t);
+
+aigman *Decanonicalize(aigman const *aig, NpnTransform const &t);
@@ -3,27 +3,99 @@
 #include <random>
 
 #include "synth.hpp"
+#include "cache.hpp"
+#include "reach.hpp"
+#include "cut.hpp"
+#include "memo.hpp"
+
+struct OptSettings {
+  int cutsize;
+  int nCutLimit; // cuts kept per node, 0 for no limit
+  bool fCutVolume;
+  int windowsize;
+  bool fAllDiv;
+  int nThreads; // windows optimized in parallel
+  bool fIncremental;
+  bool fCegar;
+  bool fBatch;
+  std::string solver;
+  int nConflictLimit;
+  double dTimeLimit; // per synthesis
+  std::function<bool()> terminator; // stops the whole optimization
+  bool fVerbose;
+  // shared by all rounds
+  int *nProblems;
+  SynthCache *cache;
+  FailureMemo *memo;
+
+  OptSettings(): cutsize(8), nCutLimit(0), fCutVolume(false), windowsize(6), fAllDiv(false), nThreads(1), fIncremental(false), fCegar(false), fBatch(false), solver("kissat"), nConflictLimit(0), dTimeLimit(0), fVerbose(false), nProblems(NULL), cache(NULL), memo(NULL) {}
+};
 
 class OptMan {
 private:
+  // gates per cut leaves, kept to update windows incrementally
+  struct Entry {
+    std::vector<int> leaves;
+    std::vector<int> direct; // gates with the cut
+    std::vector<int> gates; // gates with the cut or its subsets
+    std::vector<int> outputs;
+    bool fLarge;
+    bool fKept; // large and not included in another large one
+    bool fDirty; // gates or classification changed in the last update
+    std::vector<int> includer; // leaves of a large one including this one
+    Entry(): fLarge(false), fKept(false), fDirty(true) {}
+  };
+
   aigman &aig;
   int cutsize;
+  int nCutLimit;
+  bool fCutVolume;
   int windowsize;
   bool fAllDiv;
   bool fVerbose;
+  int nThreads;
+  bool fIncremental;
+  bool fCegar;
+  bool fBatch;
+  bool fInBatch;
+  std::string solver;
+  int nConflictLimit;
+  double dTimeLimit;
+  std::function<bool()> terminator;
+  bool fUnknown;
   std::mt19937 rg;
 
   int *nProblems;
+  SynthCache *cache;
+  FailureMemo *memo;
+
+  CutSets cuts;
+  ReachMan reach;
+  std::vector<unsigned long long> hfis;
+  std::vector<unsigned long long> hfos;
+  std::vector<int> vBatchMap;
+  std::vector<Entry> vEntries;
 
   std::vector<std::pair<std::vector<int>, std::vector<int> > > vLarge;
   std::vector<std::tuple<std::vector<int>, std::vector<int>, std::vector<int> > > vWindows;
 
+  void MergeGates(std::vector<int> const &targets);
+  void Classify(Entry &e);
+  void PruneLarge(bool fFull);
+  void CollectWindows();
+  void GenWindows();
+  void Update(std::vector<int> const &vMap, int nObjsOld, std::vector<bool> const &fChanged);
   template <typename T> void RemoveIncluded(T &s);
   template <typename T> void RemoveIncluded(T &s, bool fNoNewFo);
-  bool Synthesize(SynthMan<KissatSolver> &synthman, int nGates, std::vector<int> const &inputs, std::vector<int> const &outputs, std::string prefix = "");
+  bool Stopped() const;
+  aigman *ExSynth(BitTable const &br, BitTable const *sim, int nGates, bool &fUnknown_, std::function<bool()> const &terminator_ = nullptr);
+  bool Synthesize(BitTable const &br, BitTable const *sim, int nGates, std::vector<int> const &inputs, std::vector<int> const &outputs, std::string prefix = "");
+  void Import(aigman *aig2, int nGates, std::vector<int> const &inputs, std::vector<int> const &outputs, std::string prefix = "");
+  bool OptWindowsParallel(std::vector<std::tuple<std::vector<int>, std::vector<int>, std::vector<int> > > const &vWindows_);
+  bool OptWindowsBatch(std::vector<std::tuple<std::vector<int>, std::vector<int>, std::vector<int> > > const &vWindows_);
 
 public:
-  OptMan(aigman &aig, int cutsize, int windowsize, bool fAllDiv, int seed, bool fVerbose, int *nProblems = NULL);
+  OptMan(aigman &aig, OptSettings const &settings, int seed);
 
   void Randomize();
   bool OptWindows();
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+
+#include "kissat_solver.hpp"
+#include "cadical_solver.hpp"
+
+// races Kissat and CaDiCaL on the same clauses, and takes the first answer
+class PortfolioSolver: public Solver {
+private:
+  KissatSolver *K;
+  CadicalSolver *C;
+  Solver *winner;
+
+  void AddClause_(std::vector<int> const &vLits) {
+    K->AddClause(vLits);
+    C->AddClause(vLits);
+  }
+
+  bool Value_(int i) {
+    return winner->Value(i);
+  }
+
+  void AMO_(std::vector<int> const &vLits) {
+    Bimander(vLits, 2);
+  }
+
+  void AMK_(std::vector<int> const &vLits, int k) {
+    std::vector<int> res;
+    OddEvenSel4(vLits, res, k + 1);
+    AddClause(-res[k]);
+  }
+
+  template <typename F>
+  int Race(F const &solve) {
+    std::atomic<bool> fDone(false);
+    std::atomic<Solver *> first(nullptr);
+    StartTimer();
+    auto stop = [&]() {
+      return fDone || Stop();
+    };
+    for(Solver *S: {(Solver *)K, (Solver *)C}) {
+      S->SetTerminator(stop);
+      S->SetConflictLimit(nConflictLimit);
+    }
+    int resK = 0, resC = 0;
+    auto run = [&](Solver *S, int &res) {
+      res = solve(S);
+      if(res) {
+        Solver *expected = nullptr;
+        first.compare_exchange_strong(expected, S);
+        fDone = true;
+      }
+    };
+    std::thread t(run, K, std::ref(resK));
+    run(C, resC);
+    t.join();
+    // stop refers to locals of this race
+    for(Solver *S: {(Solver *)K, (Solver *)C}) {
+      S->SetTerminator(terminator);
+    }
+    if(!first) {
+      return 0;
+    }
+    winner = first;
+    return winner == K? resK: resC;
+  }
+
+public:
+  PortfolioSolver(): K(new KissatSolver), C(new CadicalSolver), winner(C) {}
+  ~PortfolioSolver() {
+    delete K;
+    delete C;
+  }
+
+  int Solve() {
+    return Race([](Solver *S) { return S->Solve(); });
+  }
+
+  int Solve(std::vector<int> const &assumption, std::set<int> &core) {
+    std::set<int> coreK, coreC;
+    int res = Race([&](Solver *S) { return S->Solve(assumption, S == K? coreK: coreC); });
+    if(res == -1) {
+      // CaDiCaL gives failed assumptions, and Kissat gives all of them
+      std::set<int> const &core_ = winner == K? coreK: coreC;
+      core.insert(core_.begin(), core_.end());
+    }
+    return res;
+  }
+
+  void PrintStat() {
+    K->PrintStat();
+    C->PrintStat();
+  }
+};
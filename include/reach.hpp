@@ -0,0 +1,28 @@
+#pragma once
+
+#include <aig.hpp>
+
+// reachability over fanouts, where a node reaches itself
+class ReachMan {
+private:
+  static const int nWords = 4;
+  static const int nWindow = nWords * 64;
+
+  aigman const &aig;
+  // bit k of node i is set if i reaches i + k
+  std::vector<unsigned long long> tfos;
+  std::vector<int> stamps;
+  int stamp;
+
+  void Propagate(int i);
+  bool ReachFar(std::vector<int> const &srcs, std::vector<int> const &dsts);
+
+public:
+  ReachMan(aigman const &aig);
+
+  void Build();
+  // rebuilds after renumbering, where vMap maps nodes to old ones with the same structure,
+  // and fChanged marks unmatched nodes and nodes whose fanouts differ from those of the old ones
+  void Update(std::vector<int> const &vMap, int nObjsOld, std::vector<bool> const &fChanged);
+  bool Reach(std::vector<int> const &srcs, std::vector<int> const &dsts);
+};
@@ -3,6 +3,8 @@
 #include <string>
 #include <vector>
 
-void ReadBooleanRelation(std::string fname, std::vector<std::vector<bool> > &br, std::vector<std::vector<bool> > *&sim, bool fVerbose);
+#include "bittable.hpp"
 
-void WriteBooleanRelation(std::string fname, std::vector<std::vector<bool> > const &br, std::vector<std::vector<bool> > const *sim);
+void ReadBooleanRelation(std::string fname, BitTable &br, BitTable *&sim, bool fVerbose);
+
+void WriteBooleanRelation(std::string fname, BitTable const &br, BitTable const *sim);
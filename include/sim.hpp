@@ -2,6 +2,12 @@
 
 #include <aig.hpp>
 
-void GetBooleanRelation(aigman &aig, std::vector<int> const &inputs, std::vector<int> const &outputs, std::vector<std::vector<bool> > &br);
+#include "bittable.hpp"
 
-void GetSim(aigman &aig, std::vector<int> const &inputs, std::vector<int> const &outputs, std::vector<std::vector<bool> > &sim);
+void GetBooleanRelation(aigman &aig, std::vector<int> const &inputs, std::vector<int> const &outputs, BitTable &br);
+
+void GetSim(aigman &aig, std::vector<int> const &inputs, std::vector<int> const &outputs, BitTable &sim);
+
+// rows whose output values of aig violate br, where sim gives extra inputs following the others,
+// collecting at most nLimit rows if positive
+void GetFailingRows(aigman &aig, BitTable const &br, BitTable const *sim, std::vector<int> &rows, int nLimit = 0);
@@ -2,6 +2,8 @@
 
 #include <vector>
 #include <set>
+#include <functional>
+#include <chrono>
 
 class Solver {
 private:
@@ -25,8 +27,25 @@ private:
 protected:
   int nVars;
   bool fDirect;
+  std::function<bool()> terminator;
+  int nConflictLimit;
+  double dTimeLimit;
+  std::chrono::steady_clock::time_point deadline;
 
-  Solver(): nVars(0), fDirect(true), zero(0x7fffffff), one(-0x7fffffff) {}
+  Solver(): nVars(0), fDirect(true), nConflictLimit(0), dTimeLimit(0), zero(0x7fffffff), one(-0x7fffffff) {}
+
+  // called at the beginning of each solve to start the time budget
+  void StartTimer() {
+    if(dTimeLimit > 0) {
+      deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(dTimeLimit));
+    }
+  }
+  bool HasStop() const {
+    return terminator || dTimeLimit > 0;
+  }
+  bool Stop() const {
+    return (terminator && terminator()) || (dTimeLimit > 0 && std::chrono::steady_clock::now() >= deadline);
+  }
 
   void Pairwise(std::vector<int> const &vLits);
   void Bimander(std::vector<int> const &vLits, int nbim);
@@ -51,6 +70,19 @@ public:
 
   virtual void PrintStat() = 0;
 
+  // solving stops with unknown once terminator returns true
+  void SetTerminator(std::function<bool()> const &terminator_) {
+    terminator = terminator_;
+  }
+
+  // budgets of each solve, where 0 means unlimited
+  void SetConflictLimit(int nConflictLimit_) {
+    nConflictLimit = nConflictLimit_;
+  }
+  void SetTimeLimit(double dTimeLimit_) {
+    dTimeLimit = dTimeLimit_;
+  }
+
   inline int NewVar();
 
   // TODO: Always use vector
@@ -4,12 +4,14 @@
 
 #include "kissat_solver.hpp"
 #include "cadical_solver.hpp"
+#include "portfolio_solver.hpp"
+#include "bittable.hpp"
 
 template <class T>
 class SynthMan {
 private:
   T *S;
-  std::vector<std::vector<bool> > const &br;
+  BitTable const &br;
   int nInputs;
   int nOutputs;
   int nGates;
@@ -17,14 +19,30 @@ private:
   std::vector<std::vector<int> > sels;
   std::vector<int> ponegs;
   std::vector<std::vector<int> > posels;
+  std::vector<int> acts;
 
-  std::vector<std::vector<bool> > const *sim;
+  BitTable const *sim;
   int nExtraInputs;
 
+  int nLowerBound;
+
+  std::function<bool()> terminator;
+  int nThreads;
+  int nConflictLimit;
+  double dTimeLimit;
+  bool fUnknown;
+
+  bool fCegar;
+
+  void NewSolver();
   void GenSels();
+  void AddClause(std::vector<int> vLits, int i);
   void SortSels();
   void GenOne(std::vector<int> cands, std::vector<int> const &pos);
+  void GenRow(int i);
   aigman *GetAig();
+  void GetInitialRows(std::vector<int> &rows);
+  void GetFailingRows(aigman *aig, std::vector<int> &rows);
 
   void GenSelsOld();
   void SortSelsOld();
@@ -35,19 +53,36 @@ private:
   void SortSels(std::vector<int> const &assignment);
   void GenOne(std::vector<int> cands, std::vector<int> const &pos, std::vector<int> const &assignment);
   aigman *GetAig(std::vector<int> const &assignment);
+  aigman *EnumSynthOne(std::vector<int> const &assignment);
+  aigman *EnumSynthParallel();
 
 public:
-  SynthMan(std::vector<std::vector<bool> > const &br, std::vector<std::vector<bool> > const *sim = NULL);
+  SynthMan(BitTable const &br, BitTable const *sim = NULL);
+
+  void SetTerminator(std::function<bool()> const &terminator_);
+  void SetLowerBound(int nLowerBound_);
+  void SetCegar(bool fCegar_);
+  void SetThreads(int nThreads_);
+  void SetConflictLimit(int nConflictLimit_);
+  void SetTimeLimit(double dTimeLimit_);
+
+  // whether the last failure is due to budgets or termination rather than proved
+  bool Unknown() const;
 
   aigman *Synth(int nGates_);
   aigman *ExSynth(int nGates_);
 
+  // reuses learned clauses across bounds only with CadicalSolver
+  aigman *ExIncSynth(int nGates_);
+
   aigman *EnumSynth(int nGates_);
   aigman *ExEnumSynth(int nGates_);
 
+  // prunes by failed assumption cores, which KissatSolver reports as all assumptions
   aigman *EnumSynth2(int nGates_);
   aigman *ExEnumSynth2(int nGates_);
 };
 
 template class SynthMan<KissatSolver>;
 template class SynthMan<CadicalSolver>;
+template class SynthMan<PortfolioSolver>;
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <bitset>
+
+#include "util.hpp"
+#include "bound.hpp"
+
+using namespace std;
+
+// true if some acceptable output combination of pattern i has output a equal to output b (xor c)
+static bool Compatible(BitTable const &br, int i, int a, int b, bool c) {
+  for(int j = br.FindOne(i); j < br.Cols(); j = br.FindOne(i, j + 1)) {
+    if((((j >> a) & 1) ^ ((j >> b) & 1)) == c) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int GetLowerBound(BitTable const &br, BitTable const *sim) {
+  int nInputs = clog2(br.Rows());
+  int nOutputs = clog2(br.Cols());
+  int nExtraInputs = sim? sim->Cols(): 0;
+  int nPats = br.Rows();
+  // output values each pattern can take
+  vector<unsigned> can0(nPats), can1(nPats);
+  for(int i = 0; i < nPats; i++) {
+    for(int j = br.FindOne(i); j < br.Cols(); j = br.FindOne(i, j + 1)) {
+      can0[i] |= ~j;
+      can1[i] |= j;
+    }
+  }
+  int lb = 0;
+  // support size, which is not a bound when divisors can cover inputs
+  if(!sim) {
+    vector<unsigned> supports(nOutputs);
+    unsigned support = 0;
+    for(int k = 0; k < nInputs; k++) {
+      for(int i = 0; i < nPats; i++) {
+        if((i >> k) & 1) {
+          continue;
+        }
+        int i2 = i | (1 << k);
+        if(!br.Intersects(i, i2)) {
+          support |= 1u << k;
+        }
+        for(int o = 0; o < nOutputs; o++) {
+          if((!((can1[i] >> o) & 1) && !((can0[i2] >> o) & 1)) || (!((can0[i] >> o) & 1) && !((can1[i2] >> o) & 1))) {
+            supports[o] |= 1u << k;
+          }
+        }
+      }
+    }
+    // each connected component of the circuit drives at least one output
+    lb = max(lb, (int)bitset<32>(support).count() - nOutputs);
+    for(int o = 0; o < nOutputs; o++) {
+      lb = max(lb, (int)bitset<32>(supports[o]).count() - 1);
+    }
+  }
+  // outputs that are neither constant nor a literal of an input need own gates
+  vector<int> nontrivials;
+  for(int o = 0; o < nOutputs; o++) {
+    bool fTrivial = false;
+    for(int k = -1; k < nInputs + nExtraInputs && !fTrivial; k++) {
+      for(int c = 0; c < 2 && !fTrivial; c++) {
+        fTrivial = true;
+        for(int i = 0; i < nPats; i++) {
+          bool val = c;
+          if(k >= nInputs) {
+            val ^= sim->Get(i, k - nInputs);
+          } else if(k >= 0) {
+            val ^= (i >> k) & 1;
+          }
+          if(!(((val? can1[i]: can0[i]) >> o) & 1)) {
+            fTrivial = false;
+            break;
+          }
+        }
+      }
+    }
+    if(!fTrivial) {
+      nontrivials.push_back(o);
+    }
+  }
+  // outputs that cannot be equal or complemented need distinct gates
+  vector<int> distincts;
+  for(int o: nontrivials) {
+    bool fDistinct = true;
+    for(int o2: distincts) {
+      for(int c = 0; c < 2; c++) {
+        bool fEqual = true;
+        for(int i = 0; i < nPats; i++) {
+          if(!Compatible(br, i, o, o2, c)) {
+            fEqual = false;
+            break;
+          }
+        }
+        if(fEqual) {
+          fDistinct = false;
+        }
+      }
+      if(!fDistinct) {
+        break;
+      }
+    }
+    if(fDistinct) {
+      distincts.push_back(o);
+    }
+  }
+  lb = max(lb, (int)distincts.size());
+  return lb;
+}
@@ -0,0 +1,245 @@
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "util.hpp"
+#include "cache.hpp"
+
+using namespace std;
+
+SynthCache::~SynthCache() {
+  for(auto &p: m) {
+    if(p.second.aig) {
+      delete p.second.aig;
+    }
+  }
+}
+
+string SynthCache::GetKey(BitTable const &br, BitTable const *sim) {
+  string key;
+  key += to_string(br.Rows()) + " " + to_string(br.Cols()) + " " + to_string(sim? sim->Cols(): 0) + " ";
+  key.append((char const *)br.Row(0), (size_t)br.Rows() * br.Words() * sizeof(unsigned long long));
+  if(sim) {
+    key.append((char const *)sim->Row(0), (size_t)sim->Rows() * sim->Words() * sizeof(unsigned long long));
+  }
+  return key;
+}
+
+bool SynthCache::Lookup(string const &key, int nGates, aigman *&aig, int &nLowerBound) {
+  lock_guard<mutex> lock(mtx);
+  aig = NULL;
+  nLowerBound = 0;
+  auto it = m.find(key);
+  if(it == m.end()) {
+    return false;
+  }
+  nLowerBound = it->second.nLowerBound;
+  if(nLowerBound >= nGates) {
+    return true;
+  }
+  if(it->second.aig && it->second.aig->nGates <= nLowerBound) {
+    aig = new aigman(*it->second.aig);
+    return true;
+  }
+  return false;
+}
+
+bool SynthCache::Update(string const &key, int nLowerBound, aigman const *aig) {
+  auto it = m.find(key);
+  if(it == m.end()) {
+    it = m.emplace(key, Entry{0, NULL}).first;
+  }
+  Entry &entry = it->second;
+  bool fUpdated = false;
+  if(entry.nLowerBound < nLowerBound) {
+    entry.nLowerBound = nLowerBound;
+    fUpdated = true;
+  }
+  if(aig && (!entry.aig || entry.aig->nGates > aig->nGates)) {
+    if(entry.aig) {
+      delete entry.aig;
+    }
+    entry.aig = new aigman(*aig);
+    fUpdated = true;
+  }
+  return fUpdated;
+}
+
+void SynthCache::Insert(string const &key, int nGates, aigman const *aig) {
+  lock_guard<mutex> lock(mtx);
+  bool fUpdated;
+  if(aig) {
+    // obtained by descending until UNSAT
+    fUpdated = Update(key, aig->nGates, aig);
+  } else {
+    // proved no circuit with less than nGates
+    fUpdated = Update(key, nGates, NULL);
+  }
+  if(fUpdated && f.is_open()) {
+    Append(key, m[key]);
+  }
+}
+
+/*
+  file format:
+    magic "EXOPTC02"
+    records of
+      int nKeyBytes, int nLowerBound, int nData
+      key bytes
+      nData ints of nPis nGates (fanin0 fanin1) * nGates nPos po * nPos
+  later records of the same key refine earlier ones
+*/
+
+static const char magic[] = "EXOPTC02";
+
+// sizes must agree with the record, and literals must refer to earlier objects
+static bool ValidData(vector<int> const &data) {
+  int n = data.size();
+  if(n < 3) {
+    return false;
+  }
+  int nPis = data[0];
+  int nGates = data[1];
+  if(nPis < 0 || nGates < 0 || 3 + 2 * (long long)nGates > n) {
+    return false;
+  }
+  int nPos = data[2 + nGates + nGates];
+  if(nPos < 0 || n != 3 + nGates + nGates + nPos) {
+    return false;
+  }
+  for(int i = 0; i < nGates; i++) {
+    for(int k = 0; k < 2; k++) {
+      int lit = data[2 + i + i + k];
+      if(lit < 0 || lit >= 2 * ((long long)nPis + 1 + i)) {
+        return false;
+      }
+    }
+  }
+  for(int i = 0; i < nPos; i++) {
+    int lit = data[3 + nGates + nGates + i];
+    if(lit < 0 || lit >= 2 * ((long long)nPis + 1 + nGates)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// numbers of PIs and POs must agree with the relation of the key
+static bool MatchesKey(string const &key, vector<int> const &data) {
+  int nRows, nCols, nSimCols;
+  if(sscanf(key.c_str(), "%d %d %d ", &nRows, &nCols, &nSimCols) != 3) {
+    return false;
+  }
+  int nPis = data[0];
+  int nPos = data[2 + data[1] + data[1]];
+  return nPis == clog2(nRows) + nSimCols && nPos == clog2(nCols);
+}
+
+void SynthCache::Append(string const &key, Entry const &entry) {
+  vector<int> data;
+  if(entry.aig) {
+    aigman const &aig = *entry.aig;
+    data.push_back(aig.nPis);
+    data.push_back(aig.nGates);
+    for(int i = aig.nPis + 1; i < aig.nObjs; i++) {
+      data.push_back(aig.vObjs[i + i]);
+      data.push_back(aig.vObjs[i + i + 1]);
+    }
+    data.push_back(aig.nPos);
+    data.insert(data.end(), aig.vPos.begin(), aig.vPos.end());
+  }
+  int header[3] = {(int)key.size(), entry.nLowerBound, (int)data.size()};
+  f.write((char const *)header, sizeof(header));
+  f.write(key.data(), key.size());
+  f.write((char const *)data.data(), data.size() * sizeof(int));
+  f.flush();
+}
+
+void SynthCache::Open(string const &fname) {
+  lock_guard<mutex> lock(mtx);
+  size_t nValid = 0;
+  int fd = open(fname.c_str(), O_RDONLY);
+  if(fd >= 0) {
+    struct stat st;
+    fstat(fd, &st);
+    size_t size = st.st_size;
+    char const *p = NULL;
+    if(size) {
+      p = (char const *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(p == MAP_FAILED) {
+        p = NULL;
+      }
+    }
+    close(fd);
+    if(size && (!p || size < sizeof(magic) - 1 || memcmp(p, magic, sizeof(magic) - 1))) {
+      cerr << "Ignoring cache file " << fname << " of unknown format" << endl;
+      if(p) {
+        munmap((void *)p, size);
+      }
+      return;
+    }
+    if(p) {
+      size_t pos = sizeof(magic) - 1;
+      nValid = pos;
+      while(pos + 3 * sizeof(int) <= size) {
+        int header[3];
+        memcpy(header, p + pos, sizeof(header));
+        if(header[0] < 0 || header[2] < 0) {
+          break;
+        }
+        size_t len = 3 * sizeof(int) + header[0] + header[2] * sizeof(int);
+        if(pos + len > size) {
+          break;
+        }
+        string key(p + pos + 3 * sizeof(int), header[0]);
+        vector<int> data(header[2]);
+        memcpy(data.data(), p + pos + 3 * sizeof(int) + header[0], header[2] * sizeof(int));
+        aigman *aig = NULL;
+        if(!data.empty() && !ValidData(data)) {
+          // stop at a corrupted record as at a truncated one
+          break;
+        }
+        if(!data.empty() && !MatchesKey(key, data)) {
+          // skip a record of a different relation
+          pos += len;
+          nValid = pos;
+          continue;
+        }
+        if(!data.empty()) {
+          int nPis = data[0];
+          int nGates = data[1];
+          aig = new aigman(nPis, 0);
+          for(int i = 0; i < nGates; i++) {
+            aig->newgate(data[2 + i + i], data[3 + i + i]);
+          }
+          aig->nPos = data[2 + nGates + nGates];
+          aig->vPos.assign(data.begin() + 3 + nGates + nGates, data.end());
+        }
+        Update(key, header[1], aig);
+        if(aig) {
+          delete aig;
+        }
+        pos += len;
+        nValid = pos;
+      }
+      munmap((void *)p, size);
+    }
+  }
+  // drop an incomplete record left by an interrupted run
+  if(nValid && truncate(fname.c_str(), nValid)) {
+    cerr << "Cannot append to cache file " << fname << endl;
+    return;
+  }
+  if(nValid) {
+    f.open(fname, ios::binary | ios::app);
+  } else {
+    f.open(fname, ios::binary | ios::trunc);
+    f.write(magic, sizeof(magic) - 1);
+    f.flush();
+  }
+}
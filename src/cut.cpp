@@ -1,49 +1,118 @@
 #include <algorithm>
 #include <bitset>
 
+#include <cassert>
+
 #include "cut.hpp"
 
 using namespace std;
 
 bool Dominate(Cut const &a, Cut const &b) {
-  if(a.leaves.size() > b.leaves.size()) {
+  if(a.nLeaves > b.nLeaves) {
     return false;
   }
   if((a.signature & b.signature) != a.signature) {
     return false;
   }
-  if (a.leaves.size() == b.leaves.size()) {
-    return equal(a.leaves.begin(), a.leaves.end(), b.leaves.begin());
+  if (a.nLeaves == b.nLeaves) {
+    return equal(a.begin(), a.end(), b.begin());
+  }
+  return includes(b.begin(), b.end(), a.begin(), a.end());
+}
+
+// returns false if the union has more than cutsize leaves
+bool Merge(Cut const &a, Cut const &b, Cut &c, int cutsize) {
+  int i = 0, j = 0, k = 0;
+  while(i < a.nLeaves || j < b.nLeaves) {
+    if(k == cutsize) {
+      return false;
+    }
+    if(j == b.nLeaves || (i < a.nLeaves && a.leaves[i] < b.leaves[j])) {
+      c.leaves[k++] = a.leaves[i++];
+    } else if(i == a.nLeaves || b.leaves[j] < a.leaves[i]) {
+      c.leaves[k++] = b.leaves[j++];
+    } else {
+      c.leaves[k++] = a.leaves[i++];
+      j++;
+    }
+  }
+  c.nLeaves = k;
+  c.signature = a.signature | b.signature;
+  c.volume = a.volume + b.volume + 1;
+  return true;
+}
+
+bool BySize(Cut const &a, Cut const &b) {
+  if(a.nLeaves != b.nLeaves) {
+    return a.nLeaves < b.nLeaves;
+  }
+  return a.volume > b.volume;
+}
+
+bool ByVolume(Cut const &a, Cut const &b) {
+  if(a.volume != b.volume) {
+    return a.volume > b.volume;
   }
-  return includes(b.leaves.begin(), b.leaves.end(), a.leaves.begin(), a.leaves.end());
+  return a.nLeaves < b.nLeaves;
 }
 
-void CutEnumeration(aigman const &aig, vector<vector<Cut> > &cuts, unsigned cutsize) {
-  cuts.resize(aig.nObjs);
+void CutEnumeration(aigman const &aig, CutSets &cuts, unsigned cutsize, int nCutLimit, bool fVolume, CutSets const *cuts_old, vector<int> const *vMap) {
+  assert(cutsize <= (unsigned)Cut::nMaxLeaves);
+  vector<int> vMapRev;
+  if(vMap) {
+    for(int i = 0; i < aig.nObjs; i++) {
+      int j = (*vMap)[i];
+      if(j >= 0) {
+        if(j >= (int)vMapRev.size()) {
+          vMapRev.resize(j + 1, -1);
+        }
+        vMapRev[j] = i;
+      }
+    }
+  }
+  cuts.vCuts.clear();
+  cuts.begins.assign(aig.nObjs + 1, 0);
   for(int i = 0; i < aig.nPis; i++) {
-    cuts[i + 1].emplace_back(i + 1);
+    cuts.begins[i + 1] = cuts.vCuts.size();
+    cuts.vCuts.emplace_back(i + 1);
   }
+  cuts.begins[aig.nPis + 1] = cuts.vCuts.size();
+  // cuts of the current node, kept to avoid reallocation
+  vector<Cut> cur;
   for(int i = aig.nPis + 1; i < aig.nObjs; i++) {
     int i0 = aig.vObjs[i + i] >> 1;
     int i1 = aig.vObjs[i + i + 1] >> 1;
+    cur.clear();
+    Cut new_cut;
+    if(vMap && (*vMap)[i] >= 0) {
+      // rename leaves of the old cuts
+      for(auto const &cut: (*cuts_old)[(*vMap)[i]]) {
+        new_cut = cut;
+        new_cut.signature = 0;
+        for(int k = 0; k < cut.nLeaves; k++) {
+          new_cut.leaves[k] = vMapRev[cut.leaves[k]];
+          assert(new_cut.leaves[k] >= 0);
+          new_cut.signature |= 1ull << (new_cut.leaves[k] % 64);
+        }
+        sort(new_cut.leaves, new_cut.leaves + new_cut.nLeaves);
+        cur.push_back(new_cut);
+      }
+      cuts.vCuts.insert(cuts.vCuts.end(), cur.begin(), cur.end());
+      cuts.begins[i + 1] = cuts.vCuts.size();
+      continue;
+    }
     for(auto const &cut0: cuts[i0]) {
       for(auto const &cut1: cuts[i1]) {
-        Cut new_cut;
-        auto &leaves = new_cut.leaves;
-        auto &signature = new_cut.signature;
-        signature = cut0.signature | cut1.signature;
         // merge
-        if(cut0.leaves.size() + cut1.leaves.size() > cutsize && bitset<64>(signature).count() > cutsize) {
+        if((unsigned)(cut0.nLeaves + cut1.nLeaves) > cutsize && bitset<64>(cut0.signature | cut1.signature).count() > cutsize) {
           continue;
         }
-        leaves.resize(cut0.leaves.size() + cut1.leaves.size());
-        leaves.resize(std::set_union(cut0.leaves.begin(), cut0.leaves.end(), cut1.leaves.begin(), cut1.leaves.end(), leaves.begin()) - leaves.begin());
-        if(leaves.size() > cutsize) {
+        if(!Merge(cut0, cut1, new_cut, cutsize)) {
           continue;
         }
         // skip if dominated
         bool dominated = false;
-        for(auto const &cut: cuts[i]) {
+        for(auto const &cut: cur) {
           if(Dominate(cut, new_cut)) {
             dominated = true;
             break;
@@ -53,11 +122,18 @@ void CutEnumeration(aigman const &aig, vector<vector<Cut> > &cuts, unsigned cuts
           continue;
         }
         // insert
-        cuts[i].resize(std::stable_partition(cuts[i].begin(), cuts[i].end(), [&](Cut const &cut) { return !Dominate(new_cut, cut); }) - cuts[i].begin());
-        cuts[i].push_back(new_cut);
+        cur.resize(std::stable_partition(cur.begin(), cur.end(), [&](Cut const &cut) { return !Dominate(new_cut, cut); }) - cur.begin());
+        cur.push_back(new_cut);
       }
     }
+    // priority cuts
+    if(nCutLimit > 0 && (int)cur.size() > nCutLimit) {
+      stable_sort(cur.begin(), cur.end(), fVolume? ByVolume: BySize);
+      cur.resize(nCutLimit);
+    }
     // unit cut
-    cuts[i].emplace_back(i);
+    cur.emplace_back(i);
+    cuts.vCuts.insert(cuts.vCuts.end(), cur.begin(), cur.end());
+    cuts.begins[i + 1] = cuts.vCuts.size();
   }
 }
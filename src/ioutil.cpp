@@ -1,6 +1,36 @@
 #include "ioutil.hpp"
 
 std::ostream &operator<<(std::ostream &os, Cut const &cut) {
-  os << "{" << cut.leaves << "}";
+  os << "{";
+  std::string delim;
+  for(int i: cut) {
+    os << delim << i;
+    delim = ", ";
+  }
+  os << "}";
   return os;
 }
+
+void PrintCutsWithIndex(CutSets const &cuts, std::string prefix) {
+  for(int i = 0; i < cuts.Size(); i++) {
+    std::cout << prefix << i << " : ";
+    std::string delim;
+    for(auto const &cut: cuts[i]) {
+      std::cout << delim << cut;
+      delim = ", ";
+    }
+    std::cout << std::endl;
+  }
+}
+
+void PrintTableWithIndex(BitTable const &t, std::string prefix) {
+  for(int i = 0; i < t.Rows(); i++) {
+    std::cout << prefix << i << " : ";
+    std::string delim;
+    for(int j = 0; j < t.Cols(); j++) {
+      std::cout << delim << t.Get(i, j);
+      delim = ", ";
+    }
+    std::cout << std::endl;
+  }
+}
@@ -1,3 +1,7 @@
+#include <thread>
+#include <atomic>
+#include <chrono>
+
 #include <argparse/argparse.hpp>
 
 #include "opt.hpp"
@@ -5,17 +9,72 @@
 
 using namespace std;
 
+void Optimize(aigman &aig, int round, OptSettings const &settings) {
+  mt19937 rg(round);
+  // windows are updated in place after each replacement
+  OptMan opt(aig, settings, round);
+  while(true) {
+    bool fFirst;
+    if(round == 0) {
+      fFirst = true;
+    } else if(round == 1) {
+      fFirst = false;
+    } else {
+      fFirst = rg() % 2;
+    }
+    if(round > 1) {
+      opt.Randomize();
+    }
+    if(fFirst && opt.OptWindows()) {
+      continue;
+    }
+    if(opt.OptLarge()) {
+      continue;
+    }
+    if(!fFirst && opt.OptWindows()) {
+      continue;
+    }
+    break;
+  }
+}
+
+template <class T>
+aigman *SynthRelation(BitTable const &br, BitTable const *sim, int nGates, OptSettings const &settings) {
+  SynthMan<T> synthman(br, sim);
+  synthman.SetCegar(settings.fCegar);
+  synthman.SetConflictLimit(settings.nConflictLimit);
+  synthman.SetTimeLimit(settings.dTimeLimit);
+  synthman.SetTerminator(settings.terminator);
+  if(settings.fIncremental) {
+    return synthman.ExIncSynth(nGates);
+  }
+  return synthman.ExSynth(nGates);
+}
+
 int main(int argc, char **argv) {
   argparse::ArgumentParser ap("exopt");
   ap.add_argument("input");
   ap.add_argument("output");
   ap.add_argument("-k", "--cutsize").default_value(8).scan<'i', int>();
+  ap.add_argument("-l", "--cutlimit").default_value(0).scan<'i', int>();
+  ap.add_argument("--cutvolume").default_value(false).implicit_value(true);
   ap.add_argument("-n", "--windowsize").default_value(6).scan<'i', int>();
   ap.add_argument("-a", "--alldivisors").default_value(false).implicit_value(true);
   ap.add_argument("-r", "--numrounds").default_value(10).scan<'i', int>();
   ap.add_argument("-v", "--verbose").default_value(false).implicit_value(true);
   ap.add_argument("-g", "--numgates").scan<'i', int>();
   ap.add_argument("-d", "--dump").default_value(false).implicit_value(true);
+  ap.add_argument("-t", "--threads").default_value(1).scan<'i', int>();
+  ap.add_argument("-w", "--windowthreads").default_value(1).scan<'i', int>();
+  ap.add_argument("-i", "--incremental").default_value(false).implicit_value(true);
+  ap.add_argument("-c", "--cegar").default_value(false).implicit_value(true);
+  ap.add_argument("-b", "--batch").default_value(false).implicit_value(true);
+  ap.add_argument("-s", "--solver");
+  ap.add_argument("--conflictlimit").default_value(0).scan<'i', int>();
+  ap.add_argument("--synthtimelimit").default_value(0.0).scan<'g', double>();
+  ap.add_argument("--timelimit").default_value(0.0).scan<'g', double>();
+  ap.add_argument("--nocache").default_value(false).implicit_value(true);
+  ap.add_argument("--cachefile");
   try {
     ap.parse_args(argc, argv);
   }
@@ -26,21 +85,56 @@ int main(int argc, char **argv) {
   }
   string inname = ap.get<string>("input");
   string outname = ap.get<string>("output");
-  int cutsize = ap.get<int>("--cutsize");
-  int windowsize = ap.get<int>("--windowsize");
-  bool fAllDivisors = ap.get<bool>("--alldivisors");
+  OptSettings settings;
+  settings.cutsize = ap.get<int>("--cutsize");
+  settings.nCutLimit = ap.get<int>("--cutlimit");
+  settings.fCutVolume = ap.get<bool>("--cutvolume");
+  settings.windowsize = ap.get<int>("--windowsize");
+  settings.fAllDiv = ap.get<bool>("--alldivisors");
   int numrounds = ap.get<int>("--numrounds");
   bool fDump = ap.get<bool>("--dump");
-  bool fVerbose = ap.get<bool>("--verbose");
-  mt19937 rg;
+  settings.fVerbose = ap.get<bool>("--verbose");
+  int nThreads = ap.get<int>("--threads");
+  settings.nThreads = ap.get<int>("--windowthreads");
+  settings.fIncremental = ap.get<bool>("--incremental");
+  settings.fCegar = ap.get<bool>("--cegar");
+  settings.fBatch = ap.get<bool>("--batch");
+  bool fNoCache = ap.get<bool>("--nocache");
+  // kissat starts over at each solve without learned clauses, so incremental synthesis defaults to cadical
+  settings.solver = settings.fIncremental? "cadical": "kissat";
+  if(auto solver = ap.present("--solver")) {
+    settings.solver = *solver;
+  }
+  settings.nConflictLimit = ap.get<int>("--conflictlimit");
+  settings.dTimeLimit = ap.get<double>("--synthtimelimit");
+  double dTimeLimit = ap.get<double>("--timelimit");
+  if(fNoCache && ap.present("--cachefile")) {
+    cerr << "--cachefile cannot be used with --nocache" << endl;
+    return 1;
+  }
+  if(settings.solver != "kissat" && settings.solver != "cadical" && settings.solver != "portfolio") {
+    cerr << "Unknown solver " << settings.solver << " (kissat, cadical, or portfolio)" << endl;
+    return 1;
+  }
+  // everything stops at the deadline, and the best result so far is written
+  if(dTimeLimit > 0) {
+    auto deadline = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(dTimeLimit));
+    settings.terminator = [deadline]() { return chrono::steady_clock::now() >= deadline; };
+  }
   if(inname.substr(inname.find_last_of(".") + 1) == "rel") {
     int nGates = ap.get<int>("--numgates");
-    vector<vector<bool> > br;
-    vector<vector<bool> > *sim = NULL;
-    ReadBooleanRelation(inname, br, sim, fVerbose);
-    SynthMan<KissatSolver> synthman(br, sim);
+    BitTable br;
+    BitTable *sim = NULL;
+    ReadBooleanRelation(inname, br, sim, settings.fVerbose);
     cout << "Synthesizing with at most " << nGates << " gates" << endl;
-    aigman *aig = synthman.ExSynth(nGates + 1);
+    aigman *aig;
+    if(settings.solver == "cadical") {
+      aig = SynthRelation<CadicalSolver>(br, sim, nGates + 1, settings);
+    } else if(settings.solver == "portfolio") {
+      aig = SynthRelation<PortfolioSolver>(br, sim, nGates + 1, settings);
+    } else {
+      aig = SynthRelation<KissatSolver>(br, sim, nGates + 1, settings);
+    }
     if(aig) {
       aig->write(outname);
       cout << "Synthesized with " << aig->nGates << " gates" << endl;
@@ -51,6 +145,11 @@ int main(int argc, char **argv) {
     return 0;
   }
   aigman aig_orig(inname);
+  if(settings.fAllDiv && aig_orig.nPis > 16) {
+    // every PI is an input of the window with all divisors, whose relation is exhaustive
+    cerr << "--alldivisors supports at most 16 PIs, while " << inname << " has " << aig_orig.nPis << endl;
+    return 1;
+  }
   aig_orig.supportfanouts();
   aigman aigout = aig_orig;
   int *nProblems = NULL;
@@ -58,42 +157,82 @@ int main(int argc, char **argv) {
     nProblems = new int;
     *nProblems = 0;
   }
-  for(int round = 0; round < numrounds; round++) {
-    aigman aig = aig_orig;
+  // synthesis results and failed windows are shared by all rounds
+  SynthCache *cache = NULL;
+  FailureMemo *memo = NULL;
+  if(!fNoCache) {
+    cache = new SynthCache;
+    if(auto cachefile = ap.present("--cachefile")) {
+      cache->Open(*cachefile);
+    }
+    memo = new FailureMemo;
+  }
+  settings.nProblems = nProblems;
+  settings.cache = cache;
+  settings.memo = memo;
+  if(fDump && nThreads > 1) {
+    // dumped file names depend on the order of problems
+    nThreads = 1;
+  }
+  // each round starts from the original with its own seed, so rounds are independent
+  vector<aigman *> vAigs(numrounds);
+  atomic<int> next(0);
+  atomic<int> stop(numrounds);
+  auto worker = [&]() {
     while(true) {
-      bool fFirst;
-      if(round == 0) {
-        fFirst = true;
-      } else if(round == 1) {
-        fFirst = false;
-      } else {
-        fFirst = rg() % 2;
+      int round = next++;
+      if(round >= stop || (settings.terminator && settings.terminator())) {
+        break;
       }
-      OptMan opt(aig, cutsize, windowsize, fAllDivisors, round, fVerbose, nProblems);
-      if(round > 1) {
-        opt.Randomize();
+      aigman *aig = new aigman(aig_orig);
+      Optimize(*aig, round, settings);
+      vAigs[round] = aig;
+      if(aig->nGates == aig_orig.nGates) {
+        // rounds after the first one without improvement are not needed
+        int s = stop;
+        while(round < s && !stop.compare_exchange_weak(s, round));
       }
-      if(fFirst && opt.OptWindows()) {
-        continue;
-      }
-      if(opt.OptLarge()) {
-        continue;
-      }
-      if(!fFirst && opt.OptWindows()) {
-        continue;
-      }
-      break;
     }
-    if(aig.nGates == aig_orig.nGates) {
+  };
+  if(nThreads > 1) {
+    vector<thread> threads;
+    for(int i = 0; i < nThreads; i++) {
+      threads.emplace_back(worker);
+    }
+    for(auto &t: threads) {
+      t.join();
+    }
+  } else {
+    worker();
+  }
+  bool fTimeout = settings.terminator && settings.terminator();
+  for(int round = 0; round < numrounds; round++) {
+    aigman *aig = vAigs[round];
+    if(!aig) {
+      // not started before the deadline
+      continue;
+    }
+    if(aig->nGates == aig_orig.nGates && !fTimeout) {
       break;
     }
-    if(aig.nGates < aigout.nGates) {
-      aigout = aig;
+    if(aig->nGates < aigout.nGates) {
+      aigout = *aig;
+    }
+  }
+  for(aigman *aig: vAigs) {
+    if(aig) {
+      delete aig;
     }
   }
   if(fDump) {
     delete nProblems;
   }
+  if(cache) {
+    delete cache;
+  }
+  if(memo) {
+    delete memo;
+  }
   cout << aigout.nGates << endl;
   aigout.write(outname);
   return 0;
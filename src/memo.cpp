@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <functional>
+
+#include "memo.hpp"
+
+using namespace std;
+
+bool FailureMemo::Find(unsigned long long key) {
+  lock_guard<mutex> lock(mtx);
+  return s.count(key);
+}
+
+void FailureMemo::Insert(unsigned long long key) {
+  lock_guard<mutex> lock(mtx);
+  s.insert(key);
+}
+
+static inline unsigned long long Mix(unsigned long long x) {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+static inline unsigned long long MixLit(vector<unsigned long long> const &h, int lit) {
+  return Mix(h[lit >> 1] + (lit & 1));
+}
+
+void GetStructuralHashes(aigman const &aig, vector<unsigned long long> &hfis, vector<unsigned long long> &hfos) {
+  hfis.assign(aig.nObjs, 0ull);
+  hfos.assign(aig.nObjs, 0ull);
+  for(int i = 0; i <= aig.nPis; i++) {
+    hfis[i] = Mix(i);
+  }
+  for(int i = aig.nPis + 1; i < aig.nObjs; i++) {
+    unsigned long long a = MixLit(hfis, aig.vObjs[i + i]);
+    unsigned long long b = MixLit(hfis, aig.vObjs[i + i + 1]);
+    hfis[i] = Mix(min(a, b) * 3 + max(a, b));
+  }
+  // sums over fanouts, so the order of fanouts does not matter
+  for(int i = 0; i < aig.nPos; i++) {
+    hfos[aig.vPos[i] >> 1] += Mix(aig.vPos[i] & 1);
+  }
+  for(int i = aig.nObjs - 1; i > aig.nPis; i--) {
+    for(int k = 0; k < 2; k++) {
+      int lit = aig.vObjs[i + i + k];
+      int other = aig.vObjs[i + i + 1 - k];
+      hfos[lit >> 1] += Mix(Mix(hfos[i]) * 3 + MixLit(hfis, other) + (lit & 1));
+    }
+  }
+}
+
+// fanout hash of node i from those of its fanouts
+static unsigned long long GetFanoutHash(aigman const &aig, vector<unsigned long long> const &hfis, vector<unsigned long long> const &hfos, int i) {
+  unsigned long long h = 0;
+  vector<int> fanouts = aig.vvFanouts[i];
+  sort(fanouts.begin(), fanouts.end());
+  fanouts.erase(unique(fanouts.begin(), fanouts.end()), fanouts.end());
+  for(int j: fanouts) {
+    if(j >= aig.nObjs) {
+      h += Mix(aig.vPos[j - aig.nObjs] & 1);
+      continue;
+    }
+    for(int k = 0; k < 2; k++) {
+      int lit = aig.vObjs[j + j + k];
+      int other = aig.vObjs[j + j + 1 - k];
+      if(lit >> 1 == i) {
+        h += Mix(Mix(hfos[j]) * 3 + MixLit(hfis, other) + (lit & 1));
+      }
+    }
+  }
+  return h;
+}
+
+void UpdateStructuralHashes(aigman const &aig, vector<int> const &vMap, vector<bool> const &fChanged, vector<unsigned long long> &hfis, vector<unsigned long long> &hfos) {
+  vector<unsigned long long> hfisOld, hfosOld;
+  swap(hfis, hfisOld);
+  swap(hfos, hfosOld);
+  hfis.resize(aig.nObjs);
+  hfos.resize(aig.nObjs);
+  // matched nodes have the same fanin cones
+  for(int i = 0; i <= aig.nPis; i++) {
+    hfis[i] = Mix(i);
+  }
+  for(int i = aig.nPis + 1; i < aig.nObjs; i++) {
+    if(vMap[i] >= 0) {
+      hfis[i] = hfisOld[vMap[i]];
+      continue;
+    }
+    unsigned long long a = MixLit(hfis, aig.vObjs[i + i]);
+    unsigned long long b = MixLit(hfis, aig.vObjs[i + i + 1]);
+    hfis[i] = Mix(min(a, b) * 3 + max(a, b));
+  }
+  // fanout cones differ only in the fanin cones of changed nodes
+  vector<bool> fDirty(aig.nObjs);
+  vector<int> dirties;
+  for(int i = 0; i < aig.nObjs; i++) {
+    if(fChanged[i]) {
+      fDirty[i] = true;
+      dirties.push_back(i);
+    }
+  }
+  for(int idx = 0; idx < (int)dirties.size(); idx++) {
+    int i = dirties[idx];
+    if(i <= aig.nPis) {
+      continue;
+    }
+    for(int ii = i + i; ii <= i + i + 1; ii++) {
+      int j = aig.vObjs[ii] >> 1;
+      if(!fDirty[j]) {
+        fDirty[j] = true;
+        dirties.push_back(j);
+      }
+    }
+  }
+  for(int i = 0; i < aig.nObjs; i++) {
+    if(!fDirty[i]) {
+      hfos[i] = hfosOld[vMap[i]];
+    }
+  }
+  sort(dirties.begin(), dirties.end(), greater<int>());
+  for(int i: dirties) {
+    hfos[i] = GetFanoutHash(aig, hfis, hfos, i);
+  }
+}
+
+unsigned long long GetWindowKey(vector<unsigned long long> const &hfis, vector<unsigned long long> const &hfos, vector<int> const &inputs, vector<int> const &gates, vector<int> const &outputs) {
+  // sorted, as failure does not depend on the order of inputs and outputs
+  vector<unsigned long long> v;
+  unsigned long long key = Mix(inputs.size() * 1000003ull + gates.size() * 1009ull + outputs.size());
+  for(int i: inputs) {
+    v.push_back(hfis[i]);
+  }
+  sort(v.begin(), v.end());
+  for(unsigned long long h: v) {
+    key = Mix(key ^ h);
+  }
+  v.clear();
+  for(int i: gates) {
+    v.push_back(hfis[i]);
+  }
+  sort(v.begin(), v.end());
+  for(unsigned long long h: v) {
+    key = Mix(key ^ h);
+  }
+  v.clear();
+  for(int i: outputs) {
+    v.push_back(Mix(hfis[i]) ^ hfos[i]);
+  }
+  sort(v.begin(), v.end());
+  for(unsigned long long h: v) {
+    key = Mix(key ^ h);
+  }
+  return key;
+}
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <bitset>
+#include <tuple>
+
+#include "util.hpp"
+#include "npn.hpp"
+
+using namespace std;
+
+/*
+  semi-canonical form: phases are chosen by counting forced values,
+  and inputs and outputs are sorted by these counts.
+  ties are kept in the original order, so the form is not unique,
+  but equivalent relations map to the same form in most cases.
+*/
+
+void Canonicalize(BitTable const &br, BitTable const *sim, BitTable &br_c, BitTable &sim_c, NpnTransform &t) {
+  int nInputs = clog2(br.Rows());
+  int nOutputs = clog2(br.Cols());
+  int nPats = br.Rows();
+  int nCombs = br.Cols();
+  // output values each pattern can take
+  vector<unsigned> can0(nPats), can1(nPats);
+  vector<int> nAllowed(nPats);
+  for(int i = 0; i < nPats; i++) {
+    for(int j = br.FindOne(i); j < nCombs; j = br.FindOne(i, j + 1)) {
+      can0[i] |= ~j;
+      can1[i] |= j;
+      nAllowed[i]++;
+    }
+  }
+  // output phases
+  vector<pair<int, int> > outsigs(nOutputs);
+  t.outneg = 0;
+  for(int o = 0; o < nOutputs; o++) {
+    int n0 = 0, n1 = 0;
+    for(int i = 0; i < nPats; i++) {
+      if(!((can0[i] >> o) & 1)) {
+        n1++;
+      }
+      if(!((can1[i] >> o) & 1)) {
+        n0++;
+      }
+    }
+    if(n1 > n0) {
+      swap(n0, n1);
+      t.outneg |= 1u << o;
+    }
+    outsigs[o] = make_pair(n1, n0);
+  }
+  // input phases
+  vector<int> weights(nPats);
+  for(int i = 0; i < nPats; i++) {
+    unsigned forced1 = ((~can0[i] & ~t.outneg) | (~can1[i] & t.outneg)) & ((1u << nOutputs) - 1);
+    weights[i] = nAllowed[i] * (nOutputs + 1) + bitset<32>(forced1).count();
+  }
+  vector<pair<long long, long long> > insigs(nInputs);
+  t.inneg = 0;
+  for(int k = 0; k < nInputs; k++) {
+    long long c0 = 0, c1 = 0;
+    for(int i = 0; i < nPats; i++) {
+      if((i >> k) & 1) {
+        c1 += weights[i];
+      } else {
+        c0 += weights[i];
+      }
+    }
+    if(c1 > c0) {
+      swap(c0, c1);
+      t.inneg |= 1u << k;
+    }
+    insigs[k] = make_pair(c1, c0);
+  }
+  // permutations
+  t.inperm.resize(nInputs);
+  for(int k = 0; k < nInputs; k++) {
+    t.inperm[k] = k;
+  }
+  stable_sort(t.inperm.begin(), t.inperm.end(), [&](int a, int b) { return insigs[a] < insigs[b]; });
+  t.outperm.resize(nOutputs);
+  for(int o = 0; o < nOutputs; o++) {
+    t.outperm[o] = o;
+  }
+  stable_sort(t.outperm.begin(), t.outperm.end(), [&](int a, int b) { return outsigs[a] < outsigs[b]; });
+  // phases are indexed by canonical positions
+  unsigned inneg = 0, outneg = 0;
+  for(int k = 0; k < nInputs; k++) {
+    inneg |= ((t.inneg >> t.inperm[k]) & 1) << k;
+  }
+  for(int o = 0; o < nOutputs; o++) {
+    outneg |= ((t.outneg >> t.outperm[o]) & 1) << o;
+  }
+  t.inneg = inneg;
+  t.outneg = outneg;
+  // apply
+  vector<int> pats(nPats), combs(nCombs);
+  for(int i = 0; i < nPats; i++) {
+    for(int k = 0; k < nInputs; k++) {
+      pats[i] |= (((i >> t.inperm[k]) & 1) ^ ((t.inneg >> k) & 1)) << k;
+    }
+  }
+  for(int j = 0; j < nCombs; j++) {
+    for(int o = 0; o < nOutputs; o++) {
+      combs[j] |= (((j >> t.outperm[o]) & 1) ^ ((t.outneg >> o) & 1)) << o;
+    }
+  }
+  br_c.Resize(nPats, nCombs);
+  for(int i = 0; i < nPats; i++) {
+    for(int j = br.FindOne(i); j < nCombs; j = br.FindOne(i, j + 1)) {
+      br_c.Set(pats[i], combs[j], true);
+    }
+  }
+  if(sim) {
+    sim_c.Resize(nPats, sim->Cols());
+    for(int i = 0; i < nPats; i++) {
+      copy(sim->Row(i), sim->Row(i) + sim->Words(), sim_c.Row(pats[i]));
+    }
+  } else {
+    sim_c.Resize(0, 0);
+  }
+}
+
+aigman *Decanonicalize(aigman const *aig, NpnTransform const &t) {
+  int nInputs = t.inperm.size();
+  aigman *aig2 = new aigman(aig->nPis, 0);
+  vector<int> m(aig->nObjs);
+  for(int i = 0; i < aig->nPis; i++) {
+    m[i + 1] = (i + 1) << 1;
+  }
+  for(int k = 0; k < nInputs; k++) {
+    m[k + 1] = ((t.inperm[k] + 1) << 1) ^ ((t.inneg >> k) & 1);
+  }
+  for(int i = aig->nPis + 1; i < aig->nObjs; i++) {
+    int i0 = aig->vObjs[i + i];
+    int i1 = aig->vObjs[i + i + 1];
+    m[i] = aig2->newgate(m[i0 >> 1] ^ (i0 & 1), m[i1 >> 1] ^ (i1 & 1)) << 1;
+  }
+  aig2->nPos = aig->nPos;
+  aig2->vPos.resize(aig->nPos);
+  for(int o = 0; o < aig->nPos; o++) {
+    int i = aig->vPos[o];
+    aig2->vPos[t.outperm[o]] = m[i >> 1] ^ (i & 1) ^ ((t.outneg >> o) & 1);
+  }
+  return aig2;
+}
@@ -1,6 +1,8 @@
 #include <map>
 #include <algorithm>
 #include <fstream>
+#include <thread>
+#include <atomic>
 
 #include <cassert>
 
@@ -10,57 +12,148 @@
 #include "synth.hpp"
 #include "ioutil.hpp"
 #include "rel.hpp"
+#include "npn.hpp"
 
 using namespace std;
 
-OptMan::OptMan(aigman &aig, int cutsize, int windowsize, bool fAllDiv, int seed, bool fVerbose, int *nProblems): aig(aig), cutsize(cutsize), windowsize(windowsize), fAllDiv(fAllDiv), fVerbose(fVerbose), nProblems(nProblems) {
+OptMan::OptMan(aigman &aig, OptSettings const &settings, int seed): aig(aig), cutsize(settings.cutsize), nCutLimit(settings.nCutLimit), fCutVolume(settings.fCutVolume), windowsize(settings.windowsize), fAllDiv(settings.fAllDiv), fVerbose(settings.fVerbose), nThreads(settings.nThreads), fIncremental(settings.fIncremental), fCegar(settings.fCegar), fBatch(settings.fBatch), fInBatch(false), solver(settings.solver), nConflictLimit(settings.nConflictLimit), dTimeLimit(settings.dTimeLimit), terminator(settings.terminator), fUnknown(false), nProblems(settings.nProblems), cache(settings.cache), memo(settings.memo), reach(aig) {
   // cut enumeration
-  vector<vector<Cut> > cuts;
-  CutEnumeration(aig, cuts, cutsize);
-  //PrintVecWithIndex(cuts);
-  // cut leaves to gates
-  map<vector<int>, vector<int> > m;
-  for(int i = 0; i < aig.nObjs; i++) {
-    for(auto const &cut: cuts[i]) {
-      if(cut.leaves.size() != 1) {
-        m[cut.leaves].push_back(i);
+  CutEnumeration(aig, cuts, cutsize, nCutLimit, fCutVolume);
+  //PrintCutsWithIndex(cuts);
+  GenWindows();
+  rg.seed(seed);
+}
+
+static unsigned long long GetSignature(vector<int> const &v) {
+  unsigned long long sig = 0;
+  for(int i: v) {
+    sig |= 1ull << (i % 64);
+  }
+  return sig;
+}
+
+void OptMan::MergeGates(vector<int> const &targets) {
+  // an included key has its smallest leaf in the other key, and keys with the same smallest leaf are contiguous
+  for(int idx: targets) {
+    auto &e = vEntries[idx];
+    unsigned long long sig = GetSignature(e.leaves);
+    e.gates.clear();
+    for(int i: e.leaves) {
+      auto it = lower_bound(vEntries.begin(), vEntries.end(), i, [](Entry const &e2, int i) { return e2.leaves[0] < i; });
+      for(; it != vEntries.end() && it->leaves[0] == i; it++) {
+        if(it->leaves.size() > e.leaves.size() || (GetSignature(it->leaves) & ~sig)) {
+          continue;
+        }
+        if(includes(e.leaves.begin(), e.leaves.end(), it->leaves.begin(), it->leaves.end())) {
+          e.gates.insert(e.gates.end(), it->direct.begin(), it->direct.end());
+        }
       }
     }
+    sort(e.gates.begin(), e.gates.end());
+    e.gates.erase(unique(e.gates.begin(), e.gates.end()), e.gates.end());
   }
-  for(auto it = m.begin(); it != m.end(); it++) {
-    for(auto it2 = m.begin(); it2 != m.end(); it2++) {
-      if(it == it2) {
-        continue;
+}
+
+void OptMan::Classify(Entry &e) {
+  e.outputs.clear();
+  e.fLarge = (int)e.gates.size() > windowsize || reach.Reach(e.gates, e.leaves);
+  if(e.fLarge) {
+    return;
+  }
+  vector<unsigned> v(e.gates.size());
+  for(int i: e.gates) {
+    for(int ii = i + i; ii <= i + i + 1; ii++) {
+      auto it = lower_bound(e.gates.begin(), e.gates.end(), aig.vObjs[ii] >> 1);
+      if(it != e.gates.end() && *it == aig.vObjs[ii] >> 1) {
+        v[it - e.gates.begin()]++;
       }
-      if(includes(it->first.begin(), it->first.end(), it2->first.begin(), it2->first.end())) {
-        vector<int> dest(it->second.size() + it2->second.size());
-        auto it3 = set_union(it->second.begin(), it->second.end(), it2->second.begin(), it2->second.end(), dest.begin());
-        dest.resize(it3 - dest.begin());
-        it->second = dest;
+    }
+  }
+  for(int k = 0; k < (int)e.gates.size(); k++) {
+    if(aig.vvFanouts[e.gates[k]].size() != v[k]) {
+      e.outputs.push_back(e.gates[k]);
+    }
+  }
+}
+
+void OptMan::PruneLarge(bool fFull) {
+  if(fAllDiv) {
+    return;
+  }
+  vector<int> larges, dirties;
+  vector<unsigned long long> sigs(vEntries.size());
+  for(int idx = 0; idx < (int)vEntries.size(); idx++) {
+    if(vEntries[idx].fLarge) {
+      larges.push_back(idx);
+      sigs[idx] = GetSignature(vEntries[idx].gates);
+      if(vEntries[idx].fDirty) {
+        dirties.push_back(idx);
       }
     }
   }
-  // windows
-  for(auto it = m.begin(); it != m.end(); it++) {
-    if((int)it->second.size() > windowsize || aig.reach(it->second, it->first)) {
-      if(!fAllDiv) {
-        vLarge.push_back(*it);
+  // included in gates of another one, where the one with the larger key is kept among the same gates
+  auto Included = [&](int a, int b) {
+    auto const &gates = vEntries[a].gates;
+    auto const &gates2 = vEntries[b].gates;
+    if(a == b || (sigs[a] & ~sigs[b]) || gates2.size() < gates.size() || (gates2.size() == gates.size() && b < a)) {
+      return false;
+    }
+    return includes(gates2.begin(), gates2.end(), gates.begin(), gates.end());
+  };
+  auto Find = [&](int a, vector<int> const &candidates) {
+    auto &e = vEntries[a];
+    e.fKept = true;
+    e.includer.clear();
+    for(int b: candidates) {
+      if(Included(a, b)) {
+        e.fKept = false;
+        e.includer = vEntries[b].leaves;
+        return;
       }
-      continue;
     }
-    vector<unsigned> v(aig.nObjs);
-    for(int i: it->second) {
-      for(int ii = i + i; ii <= i + i + 1; ii++) {
-        v[aig.vObjs[ii] >> 1]++;
+  };
+  if(fFull) {
+    // larger ones first, so only kept ones need to be compared against
+    sort(larges.begin(), larges.end(), [&](int a, int b) {
+      if(vEntries[a].gates.size() != vEntries[b].gates.size()) {
+        return vEntries[a].gates.size() > vEntries[b].gates.size();
+      }
+      return a > b;
+    });
+    vector<int> survivors;
+    for(int a: larges) {
+      Find(a, survivors);
+      if(vEntries[a].fKept) {
+        survivors.push_back(a);
       }
     }
-    vector<int> outputs;
-    for(auto it2 = it->second.begin(); it2 != it->second.end(); it2++) {
-      if(aig.vvFanouts[*it2].size() != v[*it2]) {
-        outputs.push_back(*it2);
+    return;
+  }
+  // inclusion between unchanged ones holds as before
+  for(int a: larges) {
+    auto &e = vEntries[a];
+    if(e.fDirty) {
+      Find(a, larges);
+    } else if(e.fKept) {
+      Find(a, dirties);
+    } else {
+      auto it = lower_bound(vEntries.begin(), vEntries.end(), e.includer, [](Entry const &e2, vector<int> const &leaves) { return e2.leaves < leaves; });
+      if(e.includer.empty() || it == vEntries.end() || it->leaves != e.includer || it->fDirty) {
+        Find(a, larges);
       }
     }
-    vWindows.push_back(make_tuple(it->first, it->second, outputs));
+  }
+}
+
+void OptMan::CollectWindows() {
+  vWindows.clear();
+  vLarge.clear();
+  for(auto const &e: vEntries) {
+    if(!e.fLarge) {
+      vWindows.push_back(make_tuple(e.leaves, e.gates, e.outputs));
+    } else if(!fAllDiv && e.fKept) {
+      vLarge.push_back(make_pair(e.leaves, e.gates));
+    }
   }
   if(fAllDiv) {
     vector<int> inputs;
@@ -72,10 +165,239 @@ OptMan::OptMan(aigman &aig, int cutsize, int windowsize, bool fAllDiv, int seed,
       gates.push_back(i);
     }
     vLarge.push_back(make_pair(inputs, gates));
-  } else {
-    RemoveIncluded(vLarge);
   }
-  rg.seed(seed);
+}
+
+void OptMan::GenWindows() {
+  GetStructuralHashes(aig, hfis, hfos);
+  // cut leaves to gates
+  map<vector<int>, vector<int> > m;
+  for(int i = 0; i < aig.nObjs; i++) {
+    for(auto const &cut: cuts[i]) {
+      if(cut.size() != 1) {
+        m[vector<int>(cut.begin(), cut.end())].push_back(i);
+      }
+    }
+  }
+  vEntries.clear();
+  vector<int> targets;
+  for(auto &p: m) {
+    targets.push_back(vEntries.size());
+    vEntries.emplace_back();
+    vEntries.back().leaves = p.first;
+    vEntries.back().direct.swap(p.second);
+  }
+  MergeGates(targets);
+  for(auto &e: vEntries) {
+    Classify(e);
+  }
+  PruneLarge(true);
+  CollectWindows();
+}
+
+// map each node to the old node with the same fanins, or -1 if none
+static void MatchNodes(aigman const &aig, vector<int> const &vObjsOld, int nObjsOld, int nPisOld, vector<int> &vMap) {
+  assert(aig.nPis == nPisOld);
+  map<pair<int, int>, vector<int> > m;
+  for(int i = nObjsOld - 1; i > nPisOld; i--) {
+    int a = vObjsOld[i + i], b = vObjsOld[i + i + 1];
+    m[make_pair(min(a, b), max(a, b))].push_back(i);
+  }
+  vMap.assign(aig.nObjs, -1);
+  for(int i = 0; i <= aig.nPis; i++) {
+    vMap[i] = i;
+  }
+  for(int i = aig.nPis + 1; i < aig.nObjs; i++) {
+    int a = aig.vObjs[i + i], b = aig.vObjs[i + i + 1];
+    if(vMap[a >> 1] < 0 || vMap[b >> 1] < 0) {
+      continue;
+    }
+    a = (vMap[a >> 1] << 1) ^ (a & 1);
+    b = (vMap[b >> 1] << 1) ^ (b & 1);
+    auto it = m.find(make_pair(min(a, b), max(a, b)));
+    if(it == m.end() || it->second.empty()) {
+      continue;
+    }
+    // each old node is matched at most once
+    vMap[i] = it->second.back();
+    it->second.pop_back();
+  }
+}
+
+// mark nodes unmatched, fanins of unmatched gates, and nodes whose fanouts differ from those of the old ones
+static void GetChangedNodes(aigman const &aig, vector<int> const &vObjsOld, vector<int> const &vPosOld, int nObjsOld, vector<int> const &vMap, vector<bool> &fChanged) {
+  vector<int> vMapRev(nObjsOld, -1);
+  for(int i = 0; i < aig.nObjs; i++) {
+    if(vMap[i] >= 0) {
+      vMapRev[vMap[i]] = i;
+    }
+  }
+  fChanged.assign(aig.nObjs, false);
+  vector<int> nFanouts(aig.nObjs), nFanoutsOld(nObjsOld);
+  for(int i = aig.nPis + 1; i < aig.nObjs; i++) {
+    for(int ii = i + i; ii <= i + i + 1; ii++) {
+      nFanouts[aig.vObjs[ii] >> 1]++;
+      if(vMap[i] < 0) {
+        fChanged[aig.vObjs[ii] >> 1] = true;
+      }
+    }
+  }
+  for(int i = aig.nPis + 1; i < nObjsOld; i++) {
+    for(int ii = i + i; ii <= i + i + 1; ii++) {
+      nFanoutsOld[vObjsOld[ii] >> 1]++;
+    }
+  }
+  for(int i = 0; i < aig.nObjs; i++) {
+    if(vMap[i] < 0 || nFanouts[i] != nFanoutsOld[vMap[i]]) {
+      fChanged[i] = true;
+    }
+  }
+  for(int k = 0; k < aig.nPos; k++) {
+    int i = aig.vPos[k] >> 1;
+    if(vMap[i] >= 0 && ((vMap[i] << 1) ^ (aig.vPos[k] & 1)) == vPosOld[k]) {
+      continue;
+    }
+    fChanged[i] = true;
+    if(vMapRev[vPosOld[k] >> 1] >= 0) {
+      fChanged[vMapRev[vPosOld[k] >> 1]] = true;
+    }
+  }
+}
+
+// rename nodes and sort them, returning false if some are removed
+static bool RenameNodes(vector<int> &v, vector<int> const &vMapRev) {
+  bool fIntact = true;
+  int j = 0;
+  for(int i: v) {
+    if(vMapRev[i] < 0) {
+      fIntact = false;
+      continue;
+    }
+    v[j++] = vMapRev[i];
+  }
+  v.resize(j);
+  sort(v.begin(), v.end());
+  return fIntact;
+}
+
+void OptMan::Update(vector<int> const &vMap, int nObjsOld, vector<bool> const &fChanged) {
+  // cuts of nodes with the same structure are reused
+  CutSets cuts_old;
+  swap(cuts, cuts_old);
+  CutEnumeration(aig, cuts, cutsize, nCutLimit, fCutVolume, &cuts_old, &vMap);
+  reach.Update(vMap, nObjsOld, fChanged);
+  vector<int> vMapRev(nObjsOld, -1);
+  for(int i = 0; i < aig.nObjs; i++) {
+    if(vMap[i] >= 0) {
+      vMapRev[vMap[i]] = i;
+    }
+  }
+  // entries are renamed, where those with removed leaves or without gates are dropped,
+  // and those which lost gates are recomputed
+  bool fSorted = true;
+  int j = 0;
+  for(int idx = 0; idx < (int)vEntries.size(); idx++) {
+    auto &e = vEntries[idx];
+    if(!RenameNodes(e.leaves, vMapRev)) {
+      continue;
+    }
+    RenameNodes(e.direct, vMapRev);
+    if(e.direct.empty()) {
+      continue;
+    }
+    e.fDirty = !RenameNodes(e.gates, vMapRev);
+    RenameNodes(e.outputs, vMapRev);
+    if(!RenameNodes(e.includer, vMapRev)) {
+      e.includer.clear();
+    }
+    if(j && !(vEntries[j - 1].leaves < e.leaves)) {
+      fSorted = false;
+    }
+    if(idx != j) {
+      vEntries[j] = move(e);
+    }
+    j++;
+  }
+  vEntries.resize(j);
+  if(!fSorted) {
+    sort(vEntries.begin(), vEntries.end(), [](Entry const &a, Entry const &b) { return a.leaves < b.leaves; });
+  }
+  // cuts of unmatched gates are added
+  vector<pair<vector<int>, int> > adds;
+  for(int i = aig.nPis + 1; i < aig.nObjs; i++) {
+    if(vMap[i] >= 0) {
+      continue;
+    }
+    for(auto const &cut: cuts[i]) {
+      if(cut.size() != 1) {
+        adds.emplace_back(vector<int>(cut.begin(), cut.end()), i);
+      }
+    }
+  }
+  sort(adds.begin(), adds.end());
+  vector<Entry> news;
+  map<int, vector<vector<int> > > added;
+  for(int idx = 0; idx < (int)adds.size(); idx++) {
+    auto const &leaves = adds[idx].first;
+    if(idx == 0 || adds[idx - 1].first != leaves) {
+      added[leaves[0]].push_back(leaves);
+    }
+    auto it = lower_bound(vEntries.begin(), vEntries.end(), leaves, [](Entry const &e, vector<int> const &leaves) { return e.leaves < leaves; });
+    if(it != vEntries.end() && it->leaves == leaves) {
+      it->direct.push_back(adds[idx].second);
+      continue;
+    }
+    if(news.empty() || news.back().leaves != leaves) {
+      news.emplace_back();
+      news.back().leaves = leaves;
+    }
+    news.back().direct.push_back(adds[idx].second);
+  }
+  int nOld = vEntries.size();
+  move(news.begin(), news.end(), back_inserter(vEntries));
+  inplace_merge(vEntries.begin(), vEntries.begin() + nOld, vEntries.end(), [](Entry const &a, Entry const &b) { return a.leaves < b.leaves; });
+  // gates are recomputed for keys including the added ones
+  vector<int> targets;
+  for(int idx = 0; idx < (int)vEntries.size(); idx++) {
+    auto &e = vEntries[idx];
+    sort(e.direct.begin(), e.direct.end());
+    for(int i: e.leaves) {
+      if(e.fDirty) {
+        break;
+      }
+      auto it = added.find(i);
+      if(it == added.end()) {
+        continue;
+      }
+      for(auto const &leaves: it->second) {
+        if(includes(e.leaves.begin(), e.leaves.end(), leaves.begin(), leaves.end())) {
+          e.fDirty = true;
+          break;
+        }
+      }
+    }
+    if(e.fDirty) {
+      targets.push_back(idx);
+    }
+  }
+  MergeGates(targets);
+  // windows are reclassified if gates are changed, while reachability to leaves
+  // is kept as leaves have the same fanin cones
+  for(auto &e: vEntries) {
+    if(!e.fDirty) {
+      for(int i: e.gates) {
+        if(fChanged[i]) {
+          e.fDirty = true;
+          break;
+        }
+      }
+    }
+    if(e.fDirty) {
+      Classify(e);
+    }
+  }
+  PruneLarge(!fSorted);
+  CollectWindows();
 }
 
 void OptMan::Randomize() {
@@ -85,40 +407,97 @@ void OptMan::Randomize() {
   }
 }
 
-bool OptMan::Synthesize(SynthMan<KissatSolver> &synthman, int nGates, vector<int> const & inputs, vector<int> const & outputs, string prefix) {
+bool OptMan::Stopped() const {
+  return terminator && terminator();
+}
+
+template <class T>
+static aigman *RunSynth(BitTable const &br, BitTable const *sim, int nGates, int nLowerBound, bool fIncremental, bool fCegar, int nConflictLimit, double dTimeLimit, function<bool()> const &terminator, bool &fUnknown) {
+  SynthMan<T> synthman(br, sim);
+  synthman.SetTerminator(terminator);
+  synthman.SetLowerBound(nLowerBound);
+  synthman.SetCegar(fCegar);
+  synthman.SetConflictLimit(nConflictLimit);
+  synthman.SetTimeLimit(dTimeLimit);
+  aigman *aig2;
+  if(fIncremental) {
+    aig2 = synthman.ExIncSynth(nGates);
+  } else {
+    aig2 = synthman.ExSynth(nGates);
+  }
+  fUnknown = synthman.Unknown();
+  return aig2;
+}
+
+aigman *OptMan::ExSynth(BitTable const &br, BitTable const *sim, int nGates, bool &fUnknown_, function<bool()> const &terminator_) {
+  fUnknown_ = false;
+  aigman *aig2;
+  string key;
+  int nLowerBound = 0;
+  BitTable br_c, sim_c;
+  NpnTransform t;
+  if(cache) {
+    // relations equal up to permutation and complementation share an entry
+    Canonicalize(br, sim, br_c, sim_c, t);
+    key = SynthCache::GetKey(br_c, sim? &sim_c: NULL);
+    if(cache->Lookup(key, nGates, aig2, nLowerBound)) {
+      // a cached circuit violating the relation is taken as a miss
+      vector<int> rows;
+      if(aig2) {
+        GetFailingRows(*aig2, br_c, sim? &sim_c: NULL, rows, 1);
+      }
+      if(rows.empty()) {
+        if(aig2) {
+          aigman *aig3 = Decanonicalize(aig2, t);
+          delete aig2;
+          aig2 = aig3;
+        }
+        return aig2;
+      }
+      delete aig2;
+      nLowerBound = 0;
+    }
+  }
+  auto const &br_ = cache? br_c: br;
+  auto const *sim_ = cache && sim? &sim_c: sim;
+  // the run is cancelled by the caller or once the whole optimization is stopped
+  function<bool()> terminator2;
+  if(terminator_ || terminator) {
+    terminator2 = [&]() { return (terminator_ && terminator_()) || Stopped(); };
+  }
+  if(solver == "cadical") {
+    aig2 = RunSynth<CadicalSolver>(br_, sim_, nGates, nLowerBound, fIncremental, fCegar, nConflictLimit, dTimeLimit, terminator2, fUnknown_);
+  } else if(solver == "portfolio") {
+    aig2 = RunSynth<PortfolioSolver>(br_, sim_, nGates, nLowerBound, fIncremental, fCegar, nConflictLimit, dTimeLimit, terminator2, fUnknown_);
+  } else {
+    aig2 = RunSynth<KissatSolver>(br_, sim_, nGates, nLowerBound, fIncremental, fCegar, nConflictLimit, dTimeLimit, terminator2, fUnknown_);
+  }
+  // results of cancelled or out-of-budget runs are not proved,
+  // while the best circuit found before is still returned
+  if(cache && !fUnknown_) {
+    cache->Insert(key, nGates, aig2);
+  }
+  if(cache && aig2) {
+    aigman *aig3 = Decanonicalize(aig2, t);
+    delete aig2;
+    aig2 = aig3;
+  }
+  return aig2;
+}
+
+bool OptMan::Synthesize(BitTable const &br, BitTable const *sim, int nGates, vector<int> const & inputs, vector<int> const & outputs, string prefix) {
   if(fVerbose) {
     cout << prefix << "Synthesizing with less than " << nGates << " gates" << endl;
   }
   aigman *aig2;
 #ifdef DEBUG
+  SynthMan<KissatSolver> synthman(br, sim);
   aig2 = synthman.Synth(nGates);
   assert(aig2);
   delete aig2;
 #endif
-  if((aig2 = synthman.ExSynth(nGates))) {
-    if(fVerbose) {
-      cout << prefix << "Synthesized with " << aig2->nGates << " gates" << endl;
-    }
-    vector<int> outputs_shift;
-    for(int i: outputs) {
-      outputs_shift.push_back(i << 1);
-    }
-    int nGatesAll = aig.nGates;
-    aig.import(aig2, inputs, outputs_shift);
-    if(fVerbose) {
-      cout << prefix << "Replaced gates : ";
-      string delim;
-      for(int i = 0; i < aig.nObjs; i++) {
-        if(aig.vDeads[i]) {
-          cout << delim << i;
-          delim = ", ";
-        }
-      }
-      cout << endl;
-    }
-    assert(nGatesAll - aig.nGates >= nGates - aig2->nGates);
-    delete aig2;
-    aig.renumber();
+  if((aig2 = ExSynth(br, sim, nGates, fUnknown))) {
+    Import(aig2, nGates, inputs, outputs, prefix);
     return true;
   }
   if(fVerbose) {
@@ -127,60 +506,345 @@ bool OptMan::Synthesize(SynthMan<KissatSolver> &synthman, int nGates, vector<int
   return false;
 }
 
-template <typename T>
-void OptMan::RemoveIncluded(T &s) {
-  for(auto it = s.begin(); it != s.end();) {
+void OptMan::Import(aigman *aig2, int nGates, vector<int> const &inputs, vector<int> const &outputs, string prefix) {
+  if(fVerbose) {
+    cout << prefix << "Synthesized with " << aig2->nGates << " gates" << endl;
+  }
+  vector<int> outputs_shift;
+  for(int i: outputs) {
+    outputs_shift.push_back(i << 1);
+  }
+  int nGatesAll = aig.nGates;
+  vector<int> vObjsOld = aig.vObjs;
+  vector<int> vPosOld = aig.vPos;
+  int nObjsOld = aig.nObjs;
+  aig.import(aig2, inputs, outputs_shift);
+  if(fVerbose) {
+    cout << prefix << "Replaced gates : ";
+    string delim;
+    for(int i = 0; i < aig.nObjs; i++) {
+      if(aig.vDeads[i]) {
+        cout << delim << i;
+        delim = ", ";
+      }
+    }
+    cout << endl;
+  }
+  assert(nGatesAll - aig.nGates >= nGates - aig2->nGates);
+  delete aig2;
+  aig.renumber();
+  vector<int> vMap;
+  MatchNodes(aig, vObjsOld, nObjsOld, aig.nPis, vMap);
+  vector<bool> fChanged;
+  GetChangedNodes(aig, vObjsOld, vPosOld, nObjsOld, vMap, fChanged);
+  UpdateStructuralHashes(aig, vMap, fChanged, hfis, hfos);
+  if(!fInBatch) {
+    Update(vMap, nObjsOld, fChanged);
+    return;
+  }
+  // windows of the batch are mapped to new ids, and updating them is deferred
+  vector<int> vMapRev(nObjsOld, -1);
+  for(int i = 0; i < aig.nObjs; i++) {
+    if(vMap[i] >= 0) {
+      vMapRev[vMap[i]] = i;
+    }
+  }
+  for(int &i: vBatchMap) {
+    if(i >= 0) {
+      i = vMapRev[i];
+    }
+  }
+}
+
+// remove elements whose gates are included in those of another element satisfying pred,
+// where the last one is kept among elements with the same gates;
+// removed elements are compared against too unless pred always holds, since inclusion
+// is transitive but pred is not
+template <typename T, typename F>
+static void RemoveIncludedIf(T &s, F const &pred, bool fTransitive) {
+  int n = s.size();
+  vector<unsigned long long> sigs(n);
+  vector<int> order(n);
+  for(int i = 0; i < n; i++) {
+    order[i] = i;
+    for(int j: get<1>(s[i])) {
+      sigs[i] |= 1ull << (j % 64);
+    }
+  }
+  // larger elements first, so an element can only be included in earlier ones
+  sort(order.begin(), order.end(), [&](int a, int b) {
+    if(get<1>(s[a]).size() != get<1>(s[b]).size()) {
+      return get<1>(s[a]).size() > get<1>(s[b]).size();
+    }
+    return a > b;
+  });
+  vector<int> survivors;
+  vector<int> visited;
+  vector<bool> fKeep(n);
+  for(int a: order) {
+    auto const &gates = get<1>(s[a]);
     bool fIncluded = false;
-    for(auto it2 = s.begin(); it2 != s.end(); it2++){
-      if(it == it2) {
+    for(int b: fTransitive? survivors: visited) {
+      if(sigs[a] & ~sigs[b]) {
         continue;
       }
-      if(includes(get<1>(*it2).begin(), get<1>(*it2).end(), get<1>(*it).begin(), get<1>(*it).end())) {
+      auto const &gates2 = get<1>(s[b]);
+      if(includes(gates2.begin(), gates2.end(), gates.begin(), gates.end()) && pred(a, b)) {
         fIncluded = true;
         break;
       }
     }
-    if(fIncluded) {
-      it = s.erase(it);
-    } else {
-      it++;
+    visited.push_back(a);
+    if(!fIncluded) {
+      survivors.push_back(a);
+      fKeep[a] = true;
+    }
+  }
+  int j = 0;
+  for(int i = 0; i < n; i++) {
+    if(fKeep[i]) {
+      if(i != j) {
+        s[j] = move(s[i]);
+      }
+      j++;
     }
   }
+  s.resize(j);
+}
+
+template <typename T>
+void OptMan::RemoveIncluded(T &s) {
+  RemoveIncludedIf(s, [](int, int) { return true; }, true);
 }
 
 template <typename T>
 void OptMan::RemoveIncluded(T &s, bool fNoNewFo) {
-  for(auto it = s.begin(); it != s.end();) {
-    bool fIncluded = false;
-    for(auto it2 = s.begin(); it2 != s.end(); it2++){
-      if(it == it2) {
-        continue;
+  if(!fNoNewFo) {
+    RemoveIncluded(s);
+    return;
+  }
+  // outputs of the including window must be reachable from the included one
+  RemoveIncludedIf(s, [&](int a, int b) {
+    for(int i: get<2>(s[b])) {
+      if(!reach.Reach(get<2>(s[a]), vector<int>{i})) {
+        return false;
       }
-      if(includes(get<1>(*it2).begin(), get<1>(*it2).end(), get<1>(*it).begin(), get<1>(*it).end())) {
-        fIncluded = true;
-        if(fNoNewFo) {
-          for(int i: get<2>(*it2)) {
-            if(!aig.reach(get<2>(*it), vector<int>{i})) {
-              fIncluded = false;
-              break;
-            }
-          }
+    }
+    return true;
+  }, false);
+}
+
+bool OptMan::OptWindowsParallel(vector<tuple<vector<int>, vector<int>, vector<int> > > const &vWindows_) {
+  // windows are synthesized speculatively, and the first success in the order is committed
+  int nWindows = vWindows_.size();
+  vector<aigman *> results(nWindows);
+  atomic<int> next(0);
+  atomic<int> found(nWindows);
+  auto worker = [&]() {
+    // simulation overwrites the AIG, so each worker has its own copy
+    aigman aig_ = aig;
+    while(true) {
+      int idx = next++;
+      if(idx >= found || Stopped()) {
+        break;
+      }
+      auto const &inputs = get<0>(vWindows_[idx]);
+      auto const &gates = get<1>(vWindows_[idx]);
+      auto const &outputs = get<2>(vWindows_[idx]);
+      unsigned long long key = 0;
+      if(memo) {
+        key = GetWindowKey(hfis, hfos, inputs, gates, outputs);
+        if(memo->Find(key)) {
+          continue;
         }
+      }
+      BitTable br;
+      GetBooleanRelation(aig_, inputs, outputs, br);
+      // cancel once an earlier window succeeds
+      bool fUnknown_;
+      aigman *aig2 = ExSynth(br, NULL, gates.size(), fUnknown_, [&]() { return found < idx; });
+      if(!aig2) {
+        // failures of cancelled runs are not proved
+        if(memo && !fUnknown_) {
+          memo->Insert(key);
+        }
+        continue;
+      }
+      if(found < idx) {
+        delete aig2;
+        continue;
+      }
+      results[idx] = aig2;
+      int f = found;
+      while(idx < f && !found.compare_exchange_weak(f, idx));
+    }
+  };
+  vector<thread> threads;
+  for(int i = 0; i < nThreads; i++) {
+    threads.emplace_back(worker);
+  }
+  for(auto &t: threads) {
+    t.join();
+  }
+  for(int i = found + 1; i < nWindows; i++) {
+    if(results[i]) {
+      delete results[i];
+    }
+  }
+  if(found == nWindows) {
+    return false;
+  }
+  auto const &inputs = get<0>(vWindows_[found]);
+  auto const &gates = get<1>(vWindows_[found]);
+  auto const &outputs = get<2>(vWindows_[found]);
+  if(fVerbose) {
+    cout << "Inputs : " << inputs << endl;
+    cout << "Gates : " << gates << endl;
+    cout << "Outputs : " << outputs << endl;
+  }
+  Import(results[found], gates.size(), inputs, outputs);
+  return true;
+}
+
+// map a window to current ids, where outputs are recomputed, returning false if it is not intact
+static bool MapWindow(aigman const &aig, vector<int> const &vMap, tuple<vector<int>, vector<int>, vector<int> > const &p, tuple<vector<int>, vector<int>, vector<int> > &p2) {
+  vector<int> inputs, gates, outputs;
+  for(int i: get<0>(p)) {
+    if(vMap[i] < 0) {
+      return false;
+    }
+    inputs.push_back(vMap[i]);
+  }
+  for(int i: get<1>(p)) {
+    if(vMap[i] < 0) {
+      return false;
+    }
+    gates.push_back(vMap[i]);
+  }
+  sort(gates.begin(), gates.end());
+  vector<int> inputs_sorted = inputs;
+  sort(inputs_sorted.begin(), inputs_sorted.end());
+  vector<unsigned> v(gates.size());
+  for(int i: gates) {
+    for(int ii = i + i; ii <= i + i + 1; ii++) {
+      int j = aig.vObjs[ii] >> 1;
+      auto it = lower_bound(gates.begin(), gates.end(), j);
+      if(it != gates.end() && *it == j) {
+        v[it - gates.begin()]++;
+      } else if(!binary_search(inputs_sorted.begin(), inputs_sorted.end(), j)) {
+        return false;
+      }
+    }
+  }
+  for(int k = 0; k < (int)gates.size(); k++) {
+    if(aig.vvFanouts[gates[k]].size() != v[k]) {
+      outputs.push_back(gates[k]);
+    }
+  }
+  p2 = make_tuple(inputs, gates, outputs);
+  return true;
+}
+
+bool OptMan::OptWindowsBatch(vector<tuple<vector<int>, vector<int>, vector<int> > > const &vWindows_) {
+  // windows separated from committed ones are committed in the same pass,
+  // where relations are computed on the updated AIG
+  vector<int> vObjsOrig = aig.vObjs;
+  vector<int> vPosOrig = aig.vPos;
+  int nObjsOrig = aig.nObjs;
+  vBatchMap.resize(nObjsOrig);
+  for(int i = 0; i < nObjsOrig; i++) {
+    vBatchMap[i] = i;
+  }
+  fInBatch = true;
+  vector<int> committed;
+  for(int idx = 0; idx < (int)vWindows_.size(); idx++) {
+    if(Stopped()) {
+      break;
+    }
+    auto const &p = vWindows_[idx];
+    vector<int> nodes = get<0>(p);
+    nodes.insert(nodes.end(), get<1>(p).begin(), get<1>(p).end());
+    bool fSeparated = true;
+    for(int idx2: committed) {
+      auto const &q = vWindows_[idx2];
+      vector<int> nodes2 = get<0>(q);
+      nodes2.insert(nodes2.end(), get<1>(q).begin(), get<1>(q).end());
+      if(reach.Reach(get<1>(q), nodes) || reach.Reach(get<1>(p), nodes2)) {
+        fSeparated = false;
         break;
       }
     }
-    if(fIncluded) {
-      it = s.erase(it);
-    } else {
-      it++;
+    if(!fSeparated) {
+      continue;
+    }
+    tuple<vector<int>, vector<int>, vector<int> > p2;
+    if(!MapWindow(aig, vBatchMap, p, p2)) {
+      continue;
+    }
+    auto const &inputs = get<0>(p2);
+    auto const &gates = get<1>(p2);
+    auto const &outputs = get<2>(p2);
+    if(outputs.empty()) {
+      continue;
+    }
+    int nGates = gates.size();
+    if(fVerbose) {
+      cout << "Inputs : " << inputs << endl;
+      cout << "Gates : " << gates << endl;
+      cout << "Outputs : " << outputs << endl;
+    }
+    unsigned long long key = 0;
+    if(memo) {
+      key = GetWindowKey(hfis, hfos, inputs, gates, outputs);
+      if(memo->Find(key)) {
+        if(fVerbose) {
+          cout << "* Synthesis failed before" << endl;
+        }
+        continue;
+      }
+    }
+    BitTable br;
+    GetBooleanRelation(aig, inputs, outputs, br);
+    if(Synthesize(br, NULL, nGates, inputs, outputs)) {
+      committed.push_back(idx);
+      continue;
+    }
+    if(memo && !fUnknown) {
+      memo->Insert(key);
+    }
+  }
+  fInBatch = false;
+  if(committed.empty()) {
+    vBatchMap.clear();
+    return false;
+  }
+  // hashes are already updated
+  vector<int> vMap(aig.nObjs, -1);
+  for(int i = 0; i < nObjsOrig; i++) {
+    if(vBatchMap[i] >= 0) {
+      vMap[vBatchMap[i]] = i;
     }
   }
+  vBatchMap.clear();
+  vector<bool> fChanged;
+  GetChangedNodes(aig, vObjsOrig, vPosOrig, nObjsOrig, vMap, fChanged);
+  Update(vMap, nObjsOrig, fChanged);
+  return true;
 }
 
 bool OptMan::OptWindows() {
   auto vWindows_ = vWindows;
   RemoveIncluded(vWindows_);
+  if(fBatch && !nProblems) {
+    return OptWindowsBatch(vWindows_);
+  }
+  if(nThreads > 1 && !nProblems) {
+    return OptWindowsParallel(vWindows_);
+  }
   for(auto const &p: vWindows_) {
+    if(Stopped()) {
+      return false;
+    }
     auto const &inputs = get<0>(p);
     auto const &gates = get<1>(p);
     auto const &outputs = get<2>(p);
@@ -190,10 +854,20 @@ bool OptMan::OptWindows() {
       cout << "Gates : " << gates << endl;
       cout << "Outputs : " << outputs << endl;
     }
+    unsigned long long key = 0;
+    if(memo && !nProblems) {
+      key = GetWindowKey(hfis, hfos, inputs, gates, outputs);
+      if(memo->Find(key)) {
+        if(fVerbose) {
+          cout << "* Synthesis failed before" << endl;
+        }
+        continue;
+      }
+    }
     // get relation
-    vector<vector<bool> > br;
+    BitTable br;
     GetBooleanRelation(aig, inputs, outputs, br);
-    //PrintVecWithIndex(br);
+    //PrintTableWithIndex(br);
     if(nProblems) {
       string fname = "case" + to_string((*nProblems)++) + ".rel";
       WriteBooleanRelation(fname, br, NULL);
@@ -201,16 +875,21 @@ bool OptMan::OptWindows() {
       f << fname << " " << nGates - 1 << endl;
     }
     // synthesis
-    SynthMan<KissatSolver> synthman(br);
-    if(Synthesize(synthman, nGates, inputs, outputs)) {
+    if(Synthesize(br, NULL, nGates, inputs, outputs)) {
       return true;
     }
+    if(memo && !nProblems && !fUnknown) {
+      memo->Insert(key);
+    }
   }
   return false;
 }
 
 bool OptMan::OptLarge() {
   for(auto const &p: vLarge) {
+    if(Stopped()) {
+      return false;
+    }
     auto const &inputs = get<0>(p);
     auto const &gates = get<1>(p);
     int nGates = gates.size();
@@ -223,13 +902,16 @@ bool OptMan::OptLarge() {
     for(auto const&q: vWindows) {
       auto const &gates2 = get<1>(q);
       auto const &outputs2 = get<2>(q);
-      if(!includes(gates.begin(), gates.end(), gates2.begin(), gates2.end()) || aig.reach(outputs2, inputs)) {
+      if(!includes(gates.begin(), gates.end(), gates2.begin(), gates2.end()) || reach.Reach(outputs2, inputs)) {
         continue;
       }
       vWindows_.push_back(q);
     }
     RemoveIncluded(vWindows_, true);
     for(auto const&q: vWindows_) {
+      if(Stopped()) {
+        return false;
+      }
       auto const &inputs2 = get<0>(q);
       auto const &gates2 = get<1>(q);
       auto const &outputs2 = get<2>(q);
@@ -243,7 +925,7 @@ bool OptMan::OptLarge() {
       v.resize(set_difference(gates.begin(), gates.end(), gates2.begin(), gates2.end(), v.begin()) - v.begin());
       vector<int> extra;
       for(auto it = v.begin(); it != v.end(); it++) {
-        if(!aig.reach(outputs2, vector<int>{*it})) {
+        if(!reach.Reach(outputs2, vector<int>{*it})) {
           extra.push_back(*it);
         }
       }
@@ -251,12 +933,12 @@ bool OptMan::OptLarge() {
         cout << "\t\tOutside gates : " << v << endl;
         cout << "\t\tExtra inputs : " << extra << endl;
       }
-      vector<vector<bool> > br;
+      BitTable br;
       GetBooleanRelation(aig, inputs, outputs2, br);
-      //PrintVecWithIndex(br, "\t\t");
-      vector<vector<bool> > sim;
+      //PrintTableWithIndex(br, "\t\t");
+      BitTable sim;
       GetSim(aig, inputs, extra, sim);
-      //PrintVecWithIndex(sim, "\t\t");
+      //PrintTableWithIndex(sim, "\t\t");
       if(nProblems) {
         string fname = "case" + to_string((*nProblems)++) + ".rel";
         WriteBooleanRelation(fname, br, &sim);
@@ -264,9 +946,8 @@ bool OptMan::OptLarge() {
         f << fname << " " << nGates2 - 1 << endl;
       }
       // synthesis
-      SynthMan<KissatSolver> synthman(br, &sim);
       extra.insert(extra.begin(), inputs.begin(), inputs.end());
-      if(Synthesize(synthman, nGates2, extra, outputs2, "\t\t")) {
+      if(Synthesize(br, &sim, nGates2, extra, outputs2, "\t\t")) {
         return true;
       }
     }
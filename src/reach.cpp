@@ -0,0 +1,167 @@
+#include <algorithm>
+
+#include "reach.hpp"
+
+using namespace std;
+
+ReachMan::ReachMan(aigman const &aig): aig(aig), stamp(0) {
+  Build();
+}
+
+void ReachMan::Propagate(int i) {
+  unsigned long long *p = tfos.data() + (size_t)i * nWords;
+  fill(p, p + nWords, 0ull);
+  p[0] = 1ull;
+  for(int j: aig.vvFanouts[i]) {
+    // fanouts beyond nObjs are POs
+    if(j >= aig.nObjs || j - i >= nWindow) {
+      continue;
+    }
+    unsigned long long const *q = tfos.data() + (size_t)j * nWords;
+    int d = j - i;
+    int o = d >> 6;
+    int r = d & 63;
+    for(int k = nWords - 1; k >= o; k--) {
+      p[k] |= q[k - o] << r;
+      if(r && k - o > 0) {
+        p[k] |= q[k - o - 1] >> (64 - r);
+      }
+    }
+  }
+}
+
+void ReachMan::Build() {
+  tfos.assign((size_t)aig.nObjs * nWords, 0ull);
+  stamps.assign(aig.nObjs, 0);
+  stamp = 0;
+  // paths between i and i + k only visit ids in between, so the window is closed
+  for(int i = aig.nObjs - 1; i >= 0; i--) {
+    Propagate(i);
+  }
+}
+
+// counts of positions where the id shift to the other side differs from that of the previous matched node
+static void GetShiftBreaks(vector<int> const &vMap, vector<int> &breaks) {
+  int n = vMap.size();
+  breaks.assign(n + 1, 0);
+  bool fFirst = true;
+  int last = 0;
+  for(int i = 0; i < n; i++) {
+    breaks[i + 1] = breaks[i];
+    if(vMap[i] < 0) {
+      continue;
+    }
+    if(!fFirst && vMap[i] - i != last) {
+      breaks[i + 1]++;
+    }
+    last = vMap[i] - i;
+    fFirst = false;
+  }
+}
+
+void ReachMan::Update(vector<int> const &vMap, int nObjsOld, vector<bool> const &fChanged) {
+  vector<unsigned long long> tfosOld;
+  swap(tfos, tfosOld);
+  tfos.assign((size_t)aig.nObjs * nWords, 0ull);
+  stamps.assign(aig.nObjs, 0);
+  stamp = 0;
+  vector<int> vMapRev(nObjsOld, -1);
+  for(int i = 0; i < aig.nObjs; i++) {
+    if(vMap[i] >= 0) {
+      vMapRev[vMap[i]] = i;
+    }
+  }
+  vector<int> breaks, breaksOld;
+  GetShiftBreaks(vMap, breaks);
+  GetShiftBreaks(vMapRev, breaksOld);
+  // nodes reaching a changed node in their windows, where seeds are visited in increasing order
+  // so that a visited node has had its fanins within the window of the current seed visited
+  vector<bool> fDirty(aig.nObjs);
+  vector<int> stack;
+  for(int i = 0; i < aig.nObjs; i++) {
+    if(!fChanged[i] || fDirty[i]) {
+      continue;
+    }
+    fDirty[i] = true;
+    stack.push_back(i);
+    while(!stack.empty()) {
+      int j = stack.back();
+      stack.pop_back();
+      if(j <= aig.nPis) {
+        continue;
+      }
+      for(int jj = j + j; jj <= j + j + 1; jj++) {
+        int k = aig.vObjs[jj] >> 1;
+        if(i - k < nWindow && !fDirty[k]) {
+          fDirty[k] = true;
+          stack.push_back(k);
+        }
+      }
+    }
+  }
+  // the others are copied if the ids in their windows are shifted uniformly
+  for(int i = aig.nObjs - 1; i >= 0; i--) {
+    int o = vMap[i];
+    if(!fDirty[i] && o >= 0) {
+      int e = min(i + nWindow, aig.nObjs);
+      int eo = min(o + nWindow, nObjsOld);
+      if(breaks[e] == breaks[i + 1] && breaksOld[eo] == breaksOld[o + 1]) {
+        copy(tfosOld.begin() + (size_t)o * nWords, tfosOld.begin() + (size_t)(o + 1) * nWords, tfos.begin() + (size_t)i * nWords);
+        continue;
+      }
+    }
+    Propagate(i);
+  }
+}
+
+bool ReachMan::ReachFar(vector<int> const &srcs, vector<int> const &dsts) {
+  int nBound = *max_element(dsts.begin(), dsts.end());
+  stamp++;
+  vector<int> stack;
+  for(int i: srcs) {
+    if(i <= nBound && stamps[i] != stamp) {
+      stamps[i] = stamp;
+      stack.push_back(i);
+    }
+  }
+  while(!stack.empty()) {
+    int i = stack.back();
+    stack.pop_back();
+    for(int j: aig.vvFanouts[i]) {
+      if(j <= nBound && stamps[j] != stamp) {
+        stamps[j] = stamp;
+        stack.push_back(j);
+      }
+    }
+  }
+  for(int i: dsts) {
+    if(stamps[i] == stamp) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ReachMan::Reach(vector<int> const &srcs, vector<int> const &dsts) {
+  bool fFar = false;
+  for(int i: srcs) {
+    unsigned long long const *p = tfos.data() + (size_t)i * nWords;
+    for(int j: dsts) {
+      int d = j - i;
+      if(d < 0) {
+        continue;
+      }
+      if(d >= nWindow) {
+        fFar = true;
+        continue;
+      }
+      if((p[d >> 6] >> (d & 63)) & 1) {
+        return true;
+      }
+    }
+  }
+  if(!fFar) {
+    return false;
+  }
+  return ReachFar(srcs, dsts);
+}
@@ -8,7 +8,7 @@
 
 using namespace std;
 
-void ReadBooleanRelation(string fname, vector<vector<bool> > &br, vector<vector<bool> > *&sim, bool fVerbose) {
+void ReadBooleanRelation(string fname, BitTable &br, BitTable *&sim, bool fVerbose) {
   ifstream f(fname);
   string line;
   getline(f, line);
@@ -35,47 +35,47 @@ void ReadBooleanRelation(string fname, vector<vector<bool> > &br, vector<vector<
   }
   // divisors
   if(nDivisors) {
-    sim = new vector<vector<bool> >(nInCombs, vector<bool>(nDivisors));
+    sim = new BitTable(nInCombs, nDivisors);
     getline(f, line);
     for(int i = 0; i < nDivisors; i++) {
       getline(f, line);
       for(int j = 0; j < nPats; j++) {
         if(line[j] == '1') {
-          (*sim)[pats[j]][i] = true;
+          sim->Set(pats[j], i, true);
         }
       }
     }
     if(fVerbose) {
       cout << "Divisors :" << endl;
-      PrintVecWithIndex(*sim);
+      PrintTableWithIndex(*sim);
     }
   }
   // outputs
-  br.resize(nInCombs, vector<bool>(nOutCombs, true));
+  br.Resize(nInCombs, nOutCombs, true);
   getline(f, line);
   for(int i = 0; i < nOutCombs; i++) {
     getline(f, line);
     for(int j = 0; j < nPats; j++) {
       if(line[j] == '0') {
-        br[pats[j]][i] = false;
+        br.Set(pats[j], i, false);
       }
     }
   }
   if(fVerbose) {
     cout << "Boolean relation :" << endl;
-    PrintVecWithIndex(br);
+    PrintTableWithIndex(br);
   }
 }
 
-void WriteBooleanRelation(string fname, vector<vector<bool> > const &br, vector<vector<bool> > const *sim) {
+void WriteBooleanRelation(string fname, BitTable const &br, BitTable const *sim) {
   ofstream f(fname);
-  int nInPats = br.size();
-  int nOutPats = br[0].size();
+  int nInPats = br.Rows();
+  int nOutPats = br.Cols();
   int nInputs = clog2(nInPats);
   int nOutputs = clog2(nOutPats);
   int nDivisors = 0;
   if(sim) {
-    nDivisors = (*sim)[0].size();
+    nDivisors = sim->Cols();
   }
   f << nInputs << " " << nDivisors << " " << nOutputs << " " << nInPats << endl << endl;
   // inputs
@@ -94,7 +94,7 @@ void WriteBooleanRelation(string fname, vector<vector<bool> > const &br, vector<
   if(nDivisors) {
     for(int i = 0; i < nDivisors; i++) {
       for(int j = 0; j < nInPats; j++) {
-        f << (*sim)[j][i];
+        f << sim->Get(j, i);
       }
       f << endl;
     }
@@ -103,7 +103,7 @@ void WriteBooleanRelation(string fname, vector<vector<bool> > const &br, vector<
   // outputs
   for(int j = 0; j < nOutPats; j++) {
     for(int i = 0; i < nInPats; i++) {
-      f << br[i][j];
+      f << br.Get(i, j);
     }
     f << endl;
   }
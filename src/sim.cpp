@@ -1,6 +1,14 @@
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <queue>
+#include <random>
+#include <functional>
 #include <cassert>
 
+#include "util.hpp"
 #include "sim.hpp"
+#include "cadical_solver.hpp"
 
 using namespace std;
 
@@ -11,20 +19,291 @@ static const unsigned long long basepats[] = {0xaaaaaaaaaaaaaaaaull,
                                               0xffff0000ffff0000ull,
                                               0xffffffff00000000ull};
 
-void GetBooleanRelation(aigman &aig, vector<int> const &inputs, vector<int> const &outputs, vector<vector<bool> > &br) {
-  assert(aig.nPis <= 16);
+// bounds of the region examined when AIG has too many PIs to simulate exhaustively
+static const int nTfoLevels = 8;
+static const int nTfiNodes = 2000;
+static const int nRandomSims = 16;
+
+// a[i] bit j becomes a[j] bit i
+static void Transpose64(unsigned long long *a) {
+  unsigned long long m = 0x00000000ffffffffull;
+  for(int j = 32; j; j >>= 1, m ^= m << j) {
+    for(int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+      unsigned long long t = ((a[k] >> j) ^ a[k | j]) & m;
+      a[k] ^= t << j;
+      a[k | j] ^= t;
+    }
+  }
+}
+
+// local structure of the fanout cone of window outputs
+struct FoCone {
+  unordered_map<int, int> locals; // index of local simulation values of outputs and nodes
+  vector<int> nodes; // focone nodes in topological order excluding outputs
+  vector<int> obs; // local nodes whose change is observable
+  vector<int> sides; // non-local fanins of nodes
+  vector<int> filits; // fanins of nodes as literals of local indices, where sides follow outputs and nodes
+};
+
+// focone is bounded to nLevels from outputs if nLevels is non-negative,
+// walking fanouts level by level so that nodes beyond the bound are not visited
+static void GetFoCone(aigman const &aig, vector<int> const &outputs, int nLevels, FoCone &fc) {
+  unordered_set<int> visited(outputs.begin(), outputs.end());
+  unordered_set<int> boundary;
+  vector<int> frontier = outputs;
+  for(int level = 1; !frontier.empty(); level++) {
+    vector<int> next;
+    for(int j: frontier) {
+      for(int i: aig.vvFanouts[j]) {
+        // fanouts beyond nObjs are POs
+        if(i >= aig.nObjs) {
+          boundary.insert(j);
+          continue;
+        }
+        if(visited.count(i)) {
+          continue;
+        }
+        if(nLevels >= 0 && level > nLevels) {
+          // fanins within the bound are observed instead
+          boundary.insert(j);
+          continue;
+        }
+        visited.insert(i);
+        next.push_back(i);
+        fc.nodes.push_back(i);
+      }
+    }
+    frontier.swap(next);
+  }
+  // ids are in topological order
+  sort(fc.nodes.begin(), fc.nodes.end());
+  int nLocals = 0;
+  for(int i: outputs) {
+    fc.locals[i] = nLocals++;
+  }
+  for(int i: fc.nodes) {
+    fc.locals[i] = nLocals++;
+  }
+  for(int i: outputs) {
+    if(boundary.count(i)) {
+      fc.obs.push_back(i);
+    }
+  }
+  for(int i: fc.nodes) {
+    if(boundary.count(i)) {
+      fc.obs.push_back(i);
+    }
+  }
+  unordered_map<int, int> m;
+  for(int i: fc.nodes) {
+    for(int ii = i + i; ii <= i + i + 1; ii++) {
+      int j = aig.vObjs[ii] >> 1;
+      auto it = fc.locals.find(j);
+      if(it == fc.locals.end()) {
+        it = m.find(j);
+        if(it == m.end()) {
+          it = m.emplace(j, nLocals + fc.sides.size()).first;
+          fc.sides.push_back(j);
+        }
+      }
+      fc.filits.push_back((it->second << 1) ^ (aig.vObjs[ii] & 1));
+    }
+  }
+}
+
+// exclude relation violated by any of current simulation patterns in aig.vSims
+static void Exclude(aigman &aig, vector<int> const &inputs, vector<int> const &outputs, FoCone const &fc, int npats, BitTable &br) {
+  int nfopats = 1 << outputs.size();
+  // lanes of FO patterns simulated at once, which are fewer than 64 for a few outputs
+  int nlanes = min(64, nfopats);
+  int nLocals = outputs.size() + fc.nodes.size();
+  vector<unsigned long long> lsims((nLocals + fc.sides.size()) * nlanes);
+  // sides have the same value in all lanes
+  for(int k = 0; k < (int)fc.sides.size(); k++) {
+    fill(lsims.begin() + (nLocals + k) * nlanes, lsims.begin() + (nLocals + k + 1) * nlanes, aig.vSims[fc.sides[k]]);
+  }
+  unsigned long long fivals[64];
+  unsigned long long diffs[64];
+  // get FI values of each pattern
+  for(int k = 0; k < 64; k++) {
+    fivals[k] = k < (int)inputs.size()? aig.vSims[inputs[k]]: 0ull;
+  }
+  Transpose64(fivals);
+  // FO patterns in groups of nlanes
+  for(int base = 0; base < nfopats; base += nlanes) {
+    for(int k = 0; k < (int)outputs.size(); k++) {
+      unsigned long long *p = lsims.data() + k * nlanes;
+      for(int l = 0; l < nlanes; l++) {
+        p[l] = ((base + l) >> k) & 1? 0xffffffffffffffffull: 0ull;
+      }
+    }
+    // run simulation from FOs for all lanes at once
+    for(int idx = 0; idx < (int)fc.nodes.size(); idx++) {
+      int a = fc.filits[idx + idx], b = fc.filits[idx + idx + 1];
+      unsigned long long const *pa = lsims.data() + (a >> 1) * nlanes;
+      unsigned long long const *pb = lsims.data() + (b >> 1) * nlanes;
+      unsigned long long ca = a & 1? 0xffffffffffffffffull: 0ull;
+      unsigned long long cb = b & 1? 0xffffffffffffffffull: 0ull;
+      unsigned long long *p = lsims.data() + (outputs.size() + idx) * nlanes;
+      for(int l = 0; l < nlanes; l++) {
+        p[l] = (pa[l] ^ ca) & (pb[l] ^ cb);
+      }
+    }
+    // exclude unnacceptable relation
+    for(int l = 0; l < 64; l++) {
+      diffs[l] = 0ull;
+    }
+    for(int i: fc.obs) {
+      unsigned long long const *p = lsims.data() + fc.locals.find(i)->second * nlanes;
+      unsigned long long c = aig.vSims[i];
+      for(int l = 0; l < nlanes; l++) {
+        diffs[l] |= p[l] ^ c;
+      }
+    }
+    Transpose64(diffs);
+    for(int j = 0; j < 64 && j < npats; j++) {
+      br.Row(fivals[j])[base >> 6] &= ~diffs[j];
+    }
+  }
+}
+
+// relation of a window in a large AIG, computed over a bounded region
+static void GetBooleanRelationSat(aigman &aig, vector<int> const &inputs, vector<int> const &outputs, BitTable &br) {
+  int nfipats = 1 << inputs.size();
+  int nfopats = 1 << outputs.size();
+  br.Resize(nfipats, nfopats, true);
+  FoCone fc;
+  GetFoCone(aig, outputs, nTfoLevels, fc);
+  if(fc.obs.empty()) {
+    return;
+  }
+  // region of TFI, where nodes beyond the budget are left free, and
+  // the budget is spent on nodes closer to the window first
+  vector<int> region;
+  unordered_set<int> gates;
+  {
+    unordered_set<int> marked;
+    queue<int> q;
+    auto push = [&](int i) {
+      if(marked.insert(i).second) {
+        q.push(i);
+      }
+    };
+    for(int i: inputs) {
+      push(i);
+    }
+    for(int i: outputs) {
+      push(i);
+    }
+    for(int i: fc.nodes) {
+      push(i);
+    }
+    int nGates = 0;
+    while(!q.empty()) {
+      int i = q.front();
+      q.pop();
+      region.push_back(i);
+      if(i <= aig.nPis || (nGates >= nTfiNodes && !fc.locals.count(i))) {
+        continue;
+      }
+      gates.insert(i);
+      nGates++;
+      push(aig.vObjs[i + i] >> 1);
+      push(aig.vObjs[i + i + 1] >> 1);
+    }
+    // ids are in topological order
+    sort(region.begin(), region.end());
+  }
+  // miter of the original region and the region with outputs replaced
+  CadicalSolver S;
+  unordered_map<int, int> vars;
+  for(int i: region) {
+    if(!i) {
+      vars[i] = S.zero;
+    } else if(!gates.count(i)) {
+      vars[i] = S.NewVar();
+    } else {
+      int a = aig.vObjs[i + i], b = aig.vObjs[i + i + 1];
+      vars[i] = S.NewVar();
+      S.And2(a & 1? -vars[a >> 1]: vars[a >> 1], b & 1? -vars[b >> 1]: vars[b >> 1], vars[i]);
+    }
+  }
+  unordered_map<int, int> vars2;
+  vector<int> ys;
+  for(int i: outputs) {
+    vars2[i] = S.NewVar();
+    ys.push_back(vars2[i]);
+  }
+  for(int i: fc.nodes) {
+    int lits[2];
+    for(int k = 0; k < 2; k++) {
+      int lit = aig.vObjs[i + i + k];
+      int v = fc.locals.count(lit >> 1)? vars2[lit >> 1]: vars[lit >> 1];
+      lits[k] = lit & 1? -v: v;
+    }
+    vars2[i] = S.And2(lits[0], lits[1]);
+  }
+  vector<int> diffs;
+  for(int i: fc.obs) {
+    diffs.push_back(S.Xor2(vars[i], vars2[i]));
+  }
+  S.AddClause(diffs);
+  // random simulation
+  aig.vSims.resize(aig.nObjs);
+  auto simulate = [&](function<unsigned long long(int)> const &f) {
+    for(int i: region) {
+      if(!i) {
+        aig.vSims[i] = 0ull;
+      } else if(!gates.count(i)) {
+        aig.vSims[i] = f(i);
+      } else {
+        aig.vSims[i] = aig.getsim(aig.vObjs[i + i]) & aig.getsim(aig.vObjs[i + i + 1]);
+      }
+    }
+  };
+  mt19937_64 rg;
+  for(int i = 0; i < nRandomSims; i++) {
+    simulate([&](int) { return rg(); });
+    Exclude(aig, inputs, outputs, fc, 64, br);
+  }
+  // check remaining relation by SAT, refining it by counterexamples
+  for(int i = 0; i < nfipats; i++) {
+    for(int j = br.FindOne(i); j < nfopats; j = br.FindOne(i, j + 1)) {
+      vector<int> assumption;
+      for(int k = 0; k < (int)inputs.size(); k++) {
+        assumption.push_back((i >> k) & 1? vars[inputs[k]]: -vars[inputs[k]]);
+      }
+      for(int k = 0; k < (int)outputs.size(); k++) {
+        assumption.push_back((j >> k) & 1? ys[k]: -ys[k]);
+      }
+      set<int> core;
+      int r = S.Solve(assumption, core);
+      if(r == -1) {
+        continue;
+      }
+      br.Set(i, j, false);
+      if(r == 1) {
+        simulate([&](int k) { return S.Value(vars[k])? 0xffffffffffffffffull: 0ull; });
+        Exclude(aig, inputs, outputs, fc, 1, br);
+      }
+    }
+  }
+}
+
+void GetBooleanRelation(aigman &aig, vector<int> const &inputs, vector<int> const &outputs, BitTable &br) {
   assert(inputs.size() <= 30);
   assert(outputs.size() <= 16);
+  if(aig.nPis > 16) {
+    GetBooleanRelationSat(aig, inputs, outputs, br);
+    return;
+  }
   // set all relation acceptable
   int nfipats = 1 << inputs.size();
   int nfopats = 1 << outputs.size();
-  br.resize(nfipats);
-  for(int i = 0; i < nfipats; i++) {
-    br[i].resize(nfopats, true);
-  }
+  br.Resize(nfipats, nfopats, true);
   // get focone
-  vector<int> focone;
-  aig.getfocone(outputs, focone);
+  FoCone fc;
+  GetFoCone(aig, outputs, -1, fc);
   // generate PI patterns
   vector<unsigned long long> inpats(basepats, basepats + 6);
   inpats.resize(aig.nPis);
@@ -39,46 +318,16 @@ void GetBooleanRelation(aigman &aig, vector<int> const &inputs, vector<int> cons
     }
     // run simulation
     aig.simulate(inpats);
-    // get PO patterns
-    vector<unsigned long long> outpats(aig.nPos);
-    for(int j = 0; j < aig.nPos; j++) {
-      outpats[j] = aig.getsim(aig.vPos[j]);
-    }
-    // get FI values
-    vector<int> fivals(min(64, ninpats));
-    for(int k = 0; k < (int)inputs.size(); k++) {
-      for(int j = 0; j < 64 && j < ninpats; j++) {
-        fivals[j] |= ((aig.vSims[inputs[k]] >> j) & 1) << k;
-      }
-    }
-    // generate FO patterns
-    for(int k = 0; k < nfopats; k++) {
-      for(int j = 0; j < (int)outputs.size(); j++) {
-        aig.vSims[outputs[j]] = (k >> j) & 1? 0xffffffffffffffffull: 0ull;
-      }
-      // run simulation from FOs
-      aig.resimulate(focone);
-      // exclude unnacceptable relation
-      unsigned long long diff = 0ull;
-      for(int j = 0; j < aig.nPos; j++) {
-        diff |= outpats[j] ^ aig.getsim(aig.vPos[j]);
-      }
-      for(int j = 0; j < 64 && j < ninpats; j++) {
-        br[fivals[j]][k] = (diff >> j) & 1? false: br[fivals[j]][k];
-      }
-    }
+    Exclude(aig, inputs, outputs, fc, ninpats, br);
   }
 }
 
-void GetSim(aigman &aig, vector<int> const &inputs, vector<int> const &outputs, vector<vector<bool> > &sim) {
+void GetSim(aigman &aig, vector<int> const &inputs, vector<int> const &outputs, BitTable &sim) {
   assert(inputs.size() <= 16);
   aig.vSims.resize(aig.nObjs);
   // allocate
   int nfipats = 1 << inputs.size();
-  sim.resize(nfipats);
-  for(int i = 0; i < nfipats; i++) {
-    sim[i].resize(outputs.size());
-  }
+  sim.Resize(nfipats, outputs.size());
   // generate input patterns
   for(int i = 0; i < (int)inputs.size() && i < 6; i++) {
     aig.vSims[inputs[i]] = basepats[i];
@@ -96,7 +345,43 @@ void GetSim(aigman &aig, vector<int> const &inputs, vector<int> const &outputs,
     // get output values
     for(int k = 0; k < (int)outputs.size(); k++) {
       for(int j = 0; j < 64 && j < nfipats; j++) {
-        sim[j + i * 64][k] = (aig.vSims[outputs[k]] >> j) & 1;
+        sim.Set(j + i * 64, k, (aig.vSims[outputs[k]] >> j) & 1);
+      }
+    }
+  }
+}
+
+void GetFailingRows(aigman &aig, BitTable const &br, BitTable const *sim, vector<int> &rows, int nLimit) {
+  int nInputs = clog2(br.Rows());
+  int nOutputs = clog2(br.Cols());
+  int nExtraInputs = sim? sim->Cols(): 0;
+  // simulate over all rows
+  vector<unsigned long long> inpats(nInputs + nExtraInputs);
+  for(int base = 0; base < br.Rows(); base += 64) {
+    int nLanes = min(64, br.Rows() - base);
+    for(int k = 0; k < nInputs + nExtraInputs; k++) {
+      inpats[k] = 0ull;
+      for(int l = 0; l < nLanes; l++) {
+        bool fVal = k < nInputs? ((base + l) >> k) & 1: sim->Get(base + l, k - nInputs);
+        inpats[k] |= (unsigned long long)fVal << l;
+      }
+    }
+    aig.simulate(inpats);
+    vector<unsigned long long> outpats(nOutputs);
+    for(int k = 0; k < nOutputs; k++) {
+      int lit = aig.vPos[k];
+      outpats[k] = lit >> 1? aig.getsim(lit): lit & 1? 0xffffffffffffffffull: 0ull;
+    }
+    for(int l = 0; l < nLanes; l++) {
+      int j = 0;
+      for(int k = 0; k < nOutputs; k++) {
+        j |= ((outpats[k] >> l) & 1) << k;
+      }
+      if(!br.Get(base + l, j)) {
+        rows.push_back(base + l);
+        if((int)rows.size() == nLimit) {
+          return;
+        }
       }
     }
   }
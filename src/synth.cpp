@@ -1,21 +1,76 @@
 #include <cassert>
 #include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <limits>
+#include <unordered_map>
 
 #include "util.hpp"
+#include "bound.hpp"
 #include "synth.hpp"
+#include "sim.hpp"
 
 using namespace std;
 
+// rows encoded first, and failing rows added per iteration, in CEGAR mode
+static const int nInitialRows = 4;
+static const int nNewRows = 4;
+
 template <class T>
-SynthMan<T>::SynthMan(vector<vector<bool> > const &br, vector<vector<bool> > const *sim): br(br), sim(sim) {
-  nInputs = clog2(br.size());
-  nOutputs = clog2(br[0].size());
+SynthMan<T>::SynthMan(BitTable const &br, BitTable const *sim): br(br), sim(sim), nThreads(1), nConflictLimit(0), dTimeLimit(0), fUnknown(false), fCegar(false) {
+  nInputs = clog2(br.Rows());
+  nOutputs = clog2(br.Cols());
   if(sim) {
-    assert(nInputs == clog2(sim->size()));
-    nExtraInputs = (*sim)[0].size();
+    assert(nInputs == clog2(sim->Rows()));
+    nExtraInputs = sim->Cols();
   } else {
     nExtraInputs = 0;
   }
+  nLowerBound = GetLowerBound(br, sim);
+}
+
+template <class T>
+void SynthMan<T>::SetTerminator(function<bool()> const &terminator_) {
+  terminator = terminator_;
+}
+
+template <class T>
+void SynthMan<T>::SetLowerBound(int nLowerBound_) {
+  nLowerBound = max(nLowerBound, nLowerBound_);
+}
+
+template <class T>
+void SynthMan<T>::SetCegar(bool fCegar_) {
+  fCegar = fCegar_;
+}
+
+template <class T>
+void SynthMan<T>::SetThreads(int nThreads_) {
+  nThreads = nThreads_;
+}
+
+template <class T>
+void SynthMan<T>::SetConflictLimit(int nConflictLimit_) {
+  nConflictLimit = nConflictLimit_;
+}
+
+template <class T>
+void SynthMan<T>::SetTimeLimit(double dTimeLimit_) {
+  dTimeLimit = dTimeLimit_;
+}
+
+template <class T>
+bool SynthMan<T>::Unknown() const {
+  return fUnknown;
+}
+
+template <class T>
+void SynthMan<T>::NewSolver() {
+  S = new T;
+  S->SetTerminator(terminator);
+  S->SetConflictLimit(nConflictLimit);
+  S->SetTimeLimit(dTimeLimit);
 }
 
 template <class T>
@@ -54,6 +109,15 @@ void SynthMan<T>::GenSels() {
   }
 }
 
+template <class T>
+void SynthMan<T>::AddClause(vector<int> vLits, int i) {
+  // clause is relaxed when gate i is inactive
+  if(!acts.empty()) {
+    vLits.push_back(-acts[i]);
+  }
+  S->AddClause(vLits);
+}
+
 template <class T>
 void SynthMan<T>::SortSels() {
   // fanin constraints for each gate
@@ -63,7 +127,7 @@ void SynthMan<T>::SortSels() {
       vLits[0] = -sels[i + i][j];
       for(int k = j + 1; k < nInputs + nExtraInputs + i - 1; k++) {
         vLits[1] = -sels[i + i + 1][k];
-        S->AddClause(vLits);
+        AddClause(vLits, i);
       }
     }
   }
@@ -74,7 +138,7 @@ void SynthMan<T>::SortSels() {
       vLits[0] = -sels[i + i + 2][j];
       for(int k = j + 1; k < nInputs + nExtraInputs + i - 1; k++) {
         vLits[1] = -sels[i + i][k];
-        S->AddClause(vLits);
+        AddClause(vLits, i + 1);
       }
     }
   }
@@ -87,7 +151,7 @@ void SynthMan<T>::SortSels() {
         vLits[2] = -sels[i + i + 2][j];
         for(int l = k + 1; l <= j; l++) {
           vLits[3] = -sels[i + i + 1][l];
-          S->AddClause(vLits);
+          AddClause(vLits, i + 1);
         }
       }
     }
@@ -100,14 +164,14 @@ void SynthMan<T>::SortSels() {
         vLits[0] = -sels[i + i][nInputs + nExtraInputs + j - 1];
         vLits[1] = -sels[j + j][k];
         vLits[2] = -sels[i + i + 1][k + 1];
-        S->AddClause(vLits);
+        AddClause(vLits, i);
       }
       for(int k = 0; k < nInputs + nExtraInputs + j - 1; k++) {
         vector<int> vLits(3);
         vLits[0] = -sels[i + i][nInputs + nExtraInputs + j - 1];
         vLits[1] = -sels[j + j + 1][k];
         vLits[2] = -sels[i + i + 1][k];
-        S->AddClause(vLits);
+        AddClause(vLits, i);
       }
     }
   }
@@ -170,6 +234,44 @@ void SynthMan<T>::GenOne(vector<int> cands, vector<int> const &pos) {
   }
 }
 
+template <class T>
+void SynthMan<T>::GenRow(int i) {
+  int nOnes = br.CountOnes(i);
+  if(nOnes == br.Cols()) {
+    return;
+  }
+  vector<int> pis(nInputs);
+  for(int k = 0; k < nInputs; k++) {
+    pis[k] = (i >> k) & 1? S->one: S->zero;
+  }
+  vector<int> exins(nExtraInputs);
+  for(int k = 0; k < nExtraInputs; k++) {
+    exins[k] = sim->Get(i, k)? S->one: S->zero;
+  }
+  vector<int> pos(nOutputs);
+  if(nOnes == 1) {
+    int j = br.FindOne(i);
+    for(int k = 0; k < nOutputs; k++) {
+      pos[k] = (j >> k) & 1? S->one: S->zero;
+    }
+  } else {
+    for(int k = 0; k < nOutputs; k++) {
+      pos[k] = S->NewVar();
+    }
+    vector<int> tmps;
+    for(int j = br.FindOne(i); j < br.Cols(); j = br.FindOne(i, j + 1)) {
+      vector<int> vLits(nOutputs);
+      for(int k = 0; k < nOutputs; k++) {
+        vLits[k] = (j >> k) & 1? pos[k]: -pos[k];
+      }
+      tmps.push_back(S->AndN(vLits));
+    }
+    S->AddClause(tmps);
+  }
+  pis.insert(pis.end(), exins.begin(), exins.end());
+  GenOne(pis, pos);
+}
+
 template <class T>
 aigman *SynthMan<T>::GetAig() {
   aigman *aig = new aigman(nInputs + nExtraInputs, 0);
@@ -213,67 +315,73 @@ aigman *SynthMan<T>::GetAig() {
   return aig;
 }
 
+template <class T>
+void SynthMan<T>::GetInitialRows(vector<int> &rows) {
+  if(!fCegar) {
+    for(int i = 0; i < br.Rows(); i++) {
+      rows.push_back(i);
+    }
+    return;
+  }
+  // most constrained rows first
+  vector<pair<int, int> > v;
+  for(int i = 0; i < br.Rows(); i++) {
+    int nOnes = br.CountOnes(i);
+    if(nOnes != br.Cols()) {
+      v.push_back(make_pair(nOnes, i));
+    }
+  }
+  sort(v.begin(), v.end());
+  for(int i = 0; i < (int)v.size() && i < nInitialRows; i++) {
+    rows.push_back(v[i].second);
+  }
+}
+
+template <class T>
+void SynthMan<T>::GetFailingRows(aigman *aig, vector<int> &rows) {
+  ::GetFailingRows(*aig, br, sim, rows, nNewRows);
+}
+
 template <class T>
 aigman *SynthMan<T>::Synth(int nGates_) {
   nGates = nGates_;
-  S = new T;
-  GenSels();
-  SortSels();
-  for(int i = 0; i < (int)br.size(); i++) {
-    int nOnes = count(br[i].begin(), br[i].end(), true);
-    if(nOnes == (int)br[i].size()) {
-      continue;
+  acts.clear();
+  fUnknown = false;
+  vector<int> rows;
+  GetInitialRows(rows);
+  while(true) {
+    // solver is rebuilt each iteration, as not all backends are incremental
+    NewSolver();
+    GenSels();
+    SortSels();
+    for(int i: rows) {
+      GenRow(i);
     }
-    vector<int> pis(nInputs);
-    for(int k = 0; k < nInputs; k++) {
-      pis[k] = (i >> k) & 1? S->one: S->zero;
+    aigman *aig = NULL;
+    int res = S->Solve();
+    if(res == 1) {
+      aig = GetAig();
     }
-    vector<int> exins(nExtraInputs);
-    for(int k = 0; k < nExtraInputs; k++) {
-      exins[k] = (*sim)[i][k]? S->one: S->zero;
+    fUnknown = !res;
+    delete S;
+    if(!aig || !fCegar) {
+      return aig;
     }
-    vector<int> pos(nOutputs);
-    if(nOnes == 1) {
-      for(int j = 0; j < (int)br[i].size(); j++) {
-        if(br[i][j]) {
-          for(int k = 0; k < nOutputs; k++) {
-            pos[k] = (j >> k) & 1? S->one: S->zero;
-          }
-          break;
-        }
-      }
-    } else {
-      for(int k = 0; k < nOutputs; k++) {
-        pos[k] = S->NewVar();
-      }
-      vector<int> tmps;
-      for(int j = 0; j < (int)br[i].size(); j++) {
-        if(br[i][j]) {
-          vector<int> vLits(nOutputs);
-          for(int k = 0; k < nOutputs; k++) {
-            vLits[k] = (j >> k) & 1? pos[k]: -pos[k];
-          }
-          tmps.push_back(S->AndN(vLits));
-        }
-      }
-      S->AddClause(tmps);
+    vector<int> fails;
+    GetFailingRows(aig, fails);
+    if(fails.empty()) {
+      return aig;
     }
-    pis.insert(pis.end(), exins.begin(), exins.end());
-    GenOne(pis, pos);
-  }
-  aigman *aig = NULL;
-  if(S->Solve() == 1) {
-    aig = GetAig();
+    delete aig;
+    rows.insert(rows.end(), fails.begin(), fails.end());
   }
-  delete S;
-  return aig;
 }
 
 template <class T>
 aigman *SynthMan<T>::ExSynth(int nGates_) {
   assert(nGates_>= 0);
   aigman *aig = NULL;
-  while(--nGates_ >= 0) {
+  while(--nGates_ >= nLowerBound) {
     aigman *aig2 = Synth(nGates_);
     if(!aig2) {
       break;
@@ -286,33 +394,244 @@ aigman *SynthMan<T>::ExSynth(int nGates_) {
   return aig;
 }
 
-void Enumerate(vector<int> &v, int i, vector<vector<int> > &all) {
-  if(i+i >= (int)v.size()) {
-    all.push_back(vector<int>(v.begin() + 2, v.end()));
-    return;
+template <class T>
+aigman *SynthMan<T>::ExIncSynth(int nGates_) {
+  assert(nGates_>= 0);
+  if(nGates_ <= nLowerBound) {
+    return NULL;
   }
-  v[i+i] = v[i+i-2];
-  if(v[i+i] == 0) {
-    v[i+i+1] = 0;
-    Enumerate(v, i+1, all);
+  // encode once for the largest count, and lower it by deactivating gates from the last
+  int nMaxGates = nGates_ - 1;
+  nGates = nMaxGates;
+  fUnknown = false;
+  NewSolver();
+  acts.resize(nGates);
+  for(int i = 0; i < nGates; i++) {
+    acts[i] = S->NewVar();
+    if(i) {
+      S->AddClause(acts[i - 1], -acts[i]);
+    }
   }
-  for(int k = v[i+i-1]; k < v[i+i]; k++) {
-    if(!k || (v[v[i+i]+v[i+i]] != k && v[v[i+i]+v[i+i]+1] != k)) {
-      v[i+i+1] = k;
-      Enumerate(v, i+1, all);
+  GenSels();
+  SortSels();
+  for(int i = 0; i < nOutputs; i++) {
+    for(int j = 0; j < nGates; j++) {
+      S->AddClause(-posels[i][nInputs + nExtraInputs + j], acts[j]);
     }
   }
-  for(int j = v[i+i-2] + 1; j < i; j++) {
-    v[i+i] = j;
-    for(int k = 0; k < j; k++) {
-      if(!k || (v[v[i+i]+v[i+i]] != k && v[v[i+i]+v[i+i]+1] != k)) {
-        v[i+i+1] = k;
-        Enumerate(v, i+1, all);
+  vector<int> rows;
+  GetInitialRows(rows);
+  for(int i: rows) {
+    GenRow(i);
+  }
+  aigman *aig = NULL;
+  for(int k = nMaxGates; k >= nLowerBound; k--) {
+    vector<int> assumption;
+    if(k < nMaxGates) {
+      assumption.push_back(-acts[k]);
+    }
+    set<int> core;
+    int res = S->Solve(assumption, core);
+    if(res != 1) {
+      fUnknown = !res;
+      break;
+    }
+    nGates = k;
+    aigman *aig2 = GetAig();
+    nGates = nMaxGates;
+    if(fCegar) {
+      // failing rows are valid for any gate count, so they are kept
+      vector<int> fails;
+      GetFailingRows(aig2, fails);
+      if(!fails.empty()) {
+        delete aig2;
+        for(int i: fails) {
+          GenRow(i);
+        }
+        k++;
+        continue;
       }
     }
+    if(aig) {
+      delete aig;
+    }
+    aig = aig2;
   }
+  acts.clear();
+  delete S;
+  return aig;
 }
 
+// yields topologies one by one, where gate i takes fanins (a, b) with b < a < i,
+// or (0, 0) for none, and pairs are non-decreasing in lexicographic order
+class TopologyEnumerator {
+private:
+  int nGates;
+  int i;
+  bool fStarted;
+  vector<int> v;
+
+  // set gate i to the first valid pair from (a, b)
+  bool Advance(int a, int b) {
+    for(; a < i; a++, b = 0) {
+      for(; b < max(a, 1); b++) {
+        if(!b || (v[a+a] != b && v[a+a+1] != b)) {
+          v[i+i] = a;
+          v[i+i+1] = b;
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+public:
+  TopologyEnumerator(int nGates): nGates(nGates), i(1), fStarted(false), v(nGates * 2 + 2) {}
+
+  bool Next(vector<int> &topology) {
+    bool fDown = !fStarted;
+    fStarted = true;
+    if(!fDown) {
+      i = nGates;
+    }
+    while(true) {
+      if(i > nGates) {
+        topology.assign(v.begin() + 2, v.end());
+        return true;
+      }
+      if(i == 0) {
+        // exhausted
+        return false;
+      }
+      if(fDown? Advance(v[i+i-2], v[i+i-1]): Advance(v[i+i], v[i+i+1] + 1)) {
+        i++;
+        fDown = true;
+      } else {
+        i--;
+        fDown = false;
+      }
+    }
+  }
+};
+
+// failed assumption sets, answering whether a set of assumptions includes any of them,
+// where each core is watched by one of its literals and filtered by a 64-bit signature
+class CoreDb {
+private:
+  vector<vector<int> > cores;
+  vector<unsigned long long> sigs;
+  vector<bool> fDeads;
+  int nDeads;
+  bool fEmpty;
+  unordered_map<int, vector<int> > watches;
+  unordered_map<int, vector<int> > occs;
+
+  static unsigned long long Signature(vector<int> const &lits) {
+    unsigned long long sig = 0;
+    for(int i: lits) {
+      sig |= 1ull << ((unsigned)(i * 0x9e3779b1u) >> 26);
+    }
+    return sig;
+  }
+
+  // drop dead cores from the lists
+  void Compact() {
+    vector<int> vMap(cores.size(), -1);
+    int j = 0;
+    for(int i = 0; i < (int)cores.size(); i++) {
+      if(!fDeads[i]) {
+        vMap[i] = j;
+        if(i != j) {
+          cores[j] = move(cores[i]);
+          sigs[j] = sigs[i];
+        }
+        j++;
+      }
+    }
+    cores.resize(j);
+    sigs.resize(j);
+    fDeads.assign(j, false);
+    nDeads = 0;
+    for(auto *m: {&watches, &occs}) {
+      for(auto &p: *m) {
+        int k = 0;
+        for(int id: p.second) {
+          if(vMap[id] >= 0) {
+            p.second[k++] = vMap[id];
+          }
+        }
+        p.second.resize(k);
+      }
+    }
+  }
+
+public:
+  CoreDb(): nDeads(0), fEmpty(false) {}
+
+  // lits must be sorted
+  bool Subsumed(vector<int> const &lits) const {
+    if(fEmpty) {
+      return true;
+    }
+    unsigned long long sig = Signature(lits);
+    for(int i: lits) {
+      auto it = watches.find(i);
+      if(it == watches.end()) {
+        continue;
+      }
+      for(int id: it->second) {
+        if(fDeads[id] || (sigs[id] & ~sig)) {
+          continue;
+        }
+        if(includes(lits.begin(), lits.end(), cores[id].begin(), cores[id].end())) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // lits must be sorted, and cores including the new one are removed
+  void Insert(vector<int> const &lits) {
+    if(lits.empty()) {
+      fEmpty = true;
+      return;
+    }
+    unsigned long long sig = Signature(lits);
+    int rare = lits[0];
+    int watch = lits[0];
+    for(int i: lits) {
+      if(occs[i].size() < occs[rare].size()) {
+        rare = i;
+      }
+      if(watches[i].size() < watches[watch].size()) {
+        watch = i;
+      }
+    }
+    // a core including the new one contains its rarest literal
+    for(int id: occs[rare]) {
+      if(fDeads[id] || (sig & ~sigs[id])) {
+        continue;
+      }
+      if(includes(cores[id].begin(), cores[id].end(), lits.begin(), lits.end())) {
+        fDeads[id] = true;
+        nDeads++;
+      }
+    }
+    int id = cores.size();
+    cores.push_back(lits);
+    sigs.push_back(sig);
+    fDeads.push_back(false);
+    watches[watch].push_back(id);
+    for(int i: lits) {
+      occs[i].push_back(id);
+    }
+    if(nDeads > 64 && nDeads * 2 > (int)cores.size()) {
+      Compact();
+    }
+  }
+};
+
 template <class T>
 void SynthMan<T>::GenSels(vector<int> const &assignment) {
   negs.clear();
@@ -495,58 +814,136 @@ aigman *SynthMan<T>::GetAig(vector<int> const &assignment) {
 }
 
 template <class T>
-aigman *SynthMan<T>::EnumSynth(int nGates_) {
-  nGates = nGates_;
-  vector<vector<int> > all;
-  vector<int> tmp(nGates * 2 + 2);
-  Enumerate(tmp, 1, all);
-  for(auto const &v: all) {
-    S = new T;
-    GenSels(v);
-    SortSels(v);
-    for(int i = 0; i < (int)br.size(); i++) {
-      bool fDc = true;
-      for(int j = 0; j < (int)br[i].size(); j++) {
-        if(!br[i][j]) {
-          fDc = false;
+aigman *SynthMan<T>::EnumSynthOne(vector<int> const &v) {
+  NewSolver();
+  GenSels(v);
+  SortSels(v);
+  for(int i = 0; i < br.Rows(); i++) {
+    if(br.IsAllOnes(i)) {
+      continue;
+    }
+    vector<int> pis(nInputs);
+    for(int k = 0; k < nInputs; k++) {
+      pis[k] = (i >> k) & 1? S->one: S->zero;
+    }
+    vector<int> exins(nExtraInputs);
+    for(int k = 0; k < nExtraInputs; k++) {
+      exins[k] = sim->Get(i, k)? S->one: S->zero;
+    }
+    vector<int> pos(nOutputs);
+    for(int k = 0; k < nOutputs; k++) {
+      pos[k] = S->NewVar();
+    }
+    vector<int> tmps;
+    for(int j = br.FindOne(i); j < br.Cols(); j = br.FindOne(i, j + 1)) {
+      vector<int> vLits(nOutputs);
+      for(int k = 0; k < nOutputs; k++) {
+        vLits[k] = (j >> k) & 1? pos[k]: -pos[k];
+      }
+      tmps.push_back(S->AndN(vLits));
+    }
+    S->AddClause(tmps);
+    pis.insert(pis.end(), exins.begin(), exins.end());
+    GenOne(pis, pos, v);
+  }
+  aigman *aig = NULL;
+  int res = S->Solve();
+  if(res == 1) {
+    aig = GetAig(v);
+  }
+  // other topologies are still tried unless terminated
+  if(!res) {
+    fUnknown = true;
+  }
+  delete S;
+  return aig;
+}
+
+template <class T>
+aigman *SynthMan<T>::EnumSynthParallel() {
+  // topologies are solved speculatively, and the first success in the order wins
+  TopologyEnumerator topologies(nGates);
+  mutex mtx;
+  int next = 0;
+  atomic<int> found(numeric_limits<int>::max());
+  aigman *result = NULL;
+  atomic<bool> fUnknown_(false);
+  auto worker = [&]() {
+    // each worker encodes into its own copy
+    SynthMan<T> synthman = *this;
+    vector<int> v;
+    while(true) {
+      int idx;
+      {
+        lock_guard<mutex> lock(mtx);
+        if(next >= found) {
+          break;
+        }
+        // only budgets of single calls leave other topologies worth trying
+        if(terminator && terminator()) {
+          fUnknown_ = true;
           break;
         }
+        if(!topologies.Next(v)) {
+          break;
+        }
+        idx = next++;
       }
-      if(fDc) {
+      // cancel once an earlier topology succeeds
+      synthman.terminator = [&, idx]() { return found < idx || (terminator && terminator()); };
+      synthman.fUnknown = false;
+      aigman *aig = synthman.EnumSynthOne(v);
+      if(!aig) {
+        // unknown results after the winner do not matter
+        if(synthman.fUnknown && !(found < idx)) {
+          fUnknown_ = true;
+        }
         continue;
       }
-      vector<int> pis(nInputs);
-      for(int k = 0; k < nInputs; k++) {
-        pis[k] = (i >> k) & 1? S->one: S->zero;
-      }
-      vector<int> exins(nExtraInputs);
-      for(int k = 0; k < nExtraInputs; k++) {
-        exins[k] = (*sim)[i][k]? S->one: S->zero;
+      lock_guard<mutex> lock(mtx);
+      if(found < idx) {
+        delete aig;
+        continue;
       }
-      vector<int> pos(nOutputs);
-      for(int k = 0; k < nOutputs; k++) {
-        pos[k] = S->NewVar();
-      }
-      vector<int> tmps;
-      for(int j = 0; j < (int)br[i].size(); j++) {
-        if(br[i][j]) {
-          vector<int> vLits(nOutputs);
-          for(int k = 0; k < nOutputs; k++) {
-            vLits[k] = (j >> k) & 1? pos[k]: -pos[k];
-          }
-          tmps.push_back(S->AndN(vLits));
-        }
+      if(result) {
+        delete result;
       }
-      S->AddClause(tmps);
-      pis.insert(pis.end(), exins.begin(), exins.end());
-      GenOne(pis, pos, v);
+      result = aig;
+      found = idx;
     }
-    if(S->Solve() == 1) {
-      aigman *aig = GetAig(v);
-      delete S;
+  };
+  vector<thread> threads;
+  for(int i = 0; i < nThreads; i++) {
+    threads.emplace_back(worker);
+  }
+  for(auto &t: threads) {
+    t.join();
+  }
+  if(!result) {
+    fUnknown = fUnknown_;
+  }
+  return result;
+}
+
+template <class T>
+aigman *SynthMan<T>::EnumSynth(int nGates_) {
+  nGates = nGates_;
+  fUnknown = false;
+  if(nThreads > 1) {
+    return EnumSynthParallel();
+  }
+  TopologyEnumerator topologies(nGates);
+  vector<int> v;
+  while(topologies.Next(v)) {
+    // only budgets of single calls leave other topologies worth trying
+    if(terminator && terminator()) {
+      fUnknown = true;
+      break;
+    }
+    aigman *aig = EnumSynthOne(v);
+    if(aig) {
       return aig;
     }
-    delete S;
   }
   return NULL;
 }
@@ -555,7 +952,7 @@ template <class T>
 aigman *SynthMan<T>::ExEnumSynth(int nGates_) {
   assert(nGates_>= 0);
   aigman *aig = NULL;
-  while(--nGates_ >= 0) {
+  while(--nGates_ >= nLowerBound) {
     aigman *aig2 = EnumSynth(nGates_);
     if(!aig2) {
       break;
@@ -571,18 +968,12 @@ aigman *SynthMan<T>::ExEnumSynth(int nGates_) {
 template <class T>
 aigman *SynthMan<T>::EnumSynth2(int nGates_) {
   nGates = nGates_;
-  S = new T;
+  fUnknown = false;
+  NewSolver();
   GenSels();
   SortSels();
-  for(int i = 0; i < (int)br.size(); i++) {
-    bool fDc = true;
-    for(int j = 0; j < (int)br[i].size(); j++) {
-      if(!br[i][j]) {
-        fDc = false;
-        break;
-      }
-    }
-    if(fDc) {
+  for(int i = 0; i < br.Rows(); i++) {
+    if(br.IsAllOnes(i)) {
       continue;
     }
     vector<int> pis(nInputs);
@@ -591,31 +982,33 @@ aigman *SynthMan<T>::EnumSynth2(int nGates_) {
     }
     vector<int> exins(nExtraInputs);
     for(int k = 0; k < nExtraInputs; k++) {
-      exins[k] = (*sim)[i][k]? S->one: S->zero;
+      exins[k] = sim->Get(i, k)? S->one: S->zero;
     }
     vector<int> pos(nOutputs);
     for(int k = 0; k < nOutputs; k++) {
       pos[k] = S->NewVar();
     }
     vector<int> tmps;
-    for(int j = 0; j < (int)br[i].size(); j++) {
-      if(br[i][j]) {
-        vector<int> vLits(nOutputs);
-        for(int k = 0; k < nOutputs; k++) {
-          vLits[k] = (j >> k) & 1? pos[k]: -pos[k];
-        }
-        tmps.push_back(S->AndN(vLits));
+    for(int j = br.FindOne(i); j < br.Cols(); j = br.FindOne(i, j + 1)) {
+      vector<int> vLits(nOutputs);
+      for(int k = 0; k < nOutputs; k++) {
+        vLits[k] = (j >> k) & 1? pos[k]: -pos[k];
       }
+      tmps.push_back(S->AndN(vLits));
     }
     S->AddClause(tmps);
     pis.insert(pis.end(), exins.begin(), exins.end());
     GenOne(pis, pos);
   }
-  vector<vector<int> > all;
-  vector<int> tmp(nGates * 2 + 2);
-  Enumerate(tmp, 1, all);
-  vector<set<int> > cores;
-  for(auto const &v: all) {
+  TopologyEnumerator topologies(nGates);
+  vector<int> v;
+  CoreDb cores;
+  while(topologies.Next(v)) {
+    // only budgets of single calls leave other topologies worth trying
+    if(terminator && terminator()) {
+      fUnknown = true;
+      break;
+    }
     vector<int> assumption;
     for(int i = 0; i < nGates; i++) {
       for(int k = 0; k < 2; k++) {
@@ -634,14 +1027,9 @@ aigman *SynthMan<T>::EnumSynth2(int nGates_) {
         }
       }
     }
-    set<int> assumption_set(assumption.begin(), assumption.end());
-    bool fIncluded = false;
-    for(auto const &core: cores) {
-      if(includes(assumption_set.begin(), assumption_set.end(), core.begin(), core.end())) {
-        fIncluded = true;
-      }
-    }
-    if(fIncluded) {
+    vector<int> assumption_sorted = assumption;
+    sort(assumption_sorted.begin(), assumption_sorted.end());
+    if(cores.Subsumed(assumption_sorted)) {
       continue;
     }
     set<int> core;
@@ -652,7 +1040,9 @@ aigman *SynthMan<T>::EnumSynth2(int nGates_) {
       return aig;
     }
     if(res == -1) {
-      cores.push_back(core);
+      cores.Insert(vector<int>(core.begin(), core.end()));
+    } else {
+      fUnknown = true;
     }
   }
   delete S;
@@ -663,7 +1053,7 @@ template <class T>
 aigman *SynthMan<T>::ExEnumSynth2(int nGates_) {
   assert(nGates_>= 0);
   aigman *aig = NULL;
-  while(--nGates_ >= 0) {
+  while(--nGates_ >= nLowerBound) {
     aigman *aig2 = EnumSynth2(nGates_);
     if(!aig2) {
       break;